@@ -1,6 +1,9 @@
 #include "include/AFS2.h"
 
+#include "include/AsyncIO.h"
+
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
@@ -8,13 +11,18 @@
 #include <iomanip>
 #include <iosfwd>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace mvgltools::afs2
 {
     constexpr auto AFS2_MAGIC_VALUE = 0x32534641;
+    // how much data may be read and not yet written, when extracting with io_uring
+    constexpr uint64_t MAX_PENDING_SIZE = 64ULL * 1024 * 1024;
 
     struct AFS2Header
     {
@@ -24,6 +32,66 @@ namespace mvgltools::afs2
         int32_t blockSize;
     };
 
+    namespace
+    {
+        auto getFileName(size_t index) -> std::string
+        {
+            std::stringstream sstream;
+            sstream << std::setw(6) << std::setfill('0') << std::hex << index << ".hca";
+            return sstream.str();
+        }
+
+        /**
+         * Extract the files using io_uring, the reads and writes of many files are in flight at once.
+         */
+        void extractAsync(AsyncIO& asyncIO,
+                          const std::vector<uint32_t>& offsets,
+                          int32_t blockSize,
+                          const std::filesystem::path& target)
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            uint64_t pendingSize = 0;
+            std::optional<std::string> error;
+
+            auto finish = [&](uint64_t size, const std::expected<void, std::string>& result)
+            {
+                const std::lock_guard lock(mutex);
+                pendingSize -= size;
+                if (!result && !error) error = result.error();
+                condition.notify_one();
+            };
+
+            for (size_t i = 0; i + 1 < offsets.size(); i++)
+            {
+                uint32_t start = (offsets[i] + blockSize - 1) & -blockSize; // NOLINT
+                uint32_t size  = offsets[i + 1] - start;
+
+                {
+                    std::unique_lock lock(mutex);
+                    condition.wait(lock, [&] { return pendingSize < MAX_PENDING_SIZE; });
+                    pendingSize += size;
+                }
+
+                auto path = target / getFileName(i);
+                asyncIO.read(start,
+                             size,
+                             [&, size, path](AsyncIO::ReadResult data)
+                             {
+                                 if (!data) return finish(size, std::unexpected(data.error()));
+                                 asyncIO.writeFile(path,
+                                                   std::move(data.value()),
+                                                   [&, size](std::expected<void, std::string> result)
+                                                   { finish(size, result); });
+                             });
+            }
+
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [&] { return pendingSize == 0; });
+            if (error) throw std::runtime_error(error.value());
+        }
+    } // namespace
+
     void extractAFS2(const std::filesystem::path& source, const std::filesystem::path& target)
     {
         if (std::filesystem::exists(target) && !std::filesystem::is_directory(target))
@@ -49,6 +117,12 @@ namespace mvgltools::afs2
 
         if (target.has_parent_path()) std::filesystem::create_directories(target);
 
+        if (auto asyncIO = AsyncIO::create(source))
+        {
+            extractAsync(*asyncIO, offsets, header.blockSize, target);
+            return;
+        }
+
         for (size_t i = 0; i < header.numFiles; i++)
         {
             input.seekg((static_cast<uint32_t>(input.tellg()) + header.blockSize - 1) & -header.blockSize); // NOLINT
@@ -57,10 +131,7 @@ namespace mvgltools::afs2
             std::vector<char> data(size);
             input.read(data.data(), size);
 
-            std::stringstream sstream;
-            sstream << std::setw(6) << std::setfill('0') << std::hex << i << ".hca";
-
-            std::filesystem::path path(target / sstream.str());
+            std::filesystem::path path(target / getFileName(i));
             std::ofstream output(path, std::ios::out | std::ios::binary);
 
             output.write(data.data(), size);
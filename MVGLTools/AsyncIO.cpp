@@ -0,0 +1,505 @@
+#include "AsyncIO.h"
+
+#ifdef MVGLTOOLS_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef MVGLTOOLS_IO_URING
+namespace
+{
+    // the length of an io_uring read or write is 32 bit, larger transfers are split up
+    constexpr uint64_t MAX_TRANSFER_SIZE = 1ULL << 30;
+
+    auto errorString(int result) -> std::string
+    {
+        return std::strerror(-result); // NOLINT(concurrency-mt-unsafe)
+    }
+
+    auto loadAcquire(uint32_t* value) -> uint32_t
+    {
+        return std::atomic_ref(*value).load(std::memory_order_acquire);
+    }
+
+    void storeRelease(uint32_t* value, uint32_t newValue)
+    {
+        std::atomic_ref(*value).store(newValue, std::memory_order_release);
+    }
+
+    template<typename T>
+    auto offsetPointer(void* base, uint32_t offset) -> T*
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset); // NOLINT
+    }
+
+    /**
+     * Check whether the kernel supports all the operations used, io_uring itself exists since 5.1 but open and close
+     * were only added in 5.6.
+     */
+    auto supportsOperations(int ringFd) -> bool
+    {
+        constexpr auto PROBE_COUNT = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + (PROBE_COUNT * sizeof(io_uring_probe_op)));
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+        if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, PROBE_COUNT) < 0) return false;
+
+        auto isSupported = [probe](uint8_t operation)
+        {
+            return operation <= probe->last_op &&
+                   (probe->ops[operation].flags & IO_URING_OP_SUPPORTED) != 0; // NOLINT
+        };
+        return isSupported(IORING_OP_READ) && isSupported(IORING_OP_WRITE) && isSupported(IORING_OP_OPENAT) &&
+               isSupported(IORING_OP_CLOSE);
+    }
+} // namespace
+#endif
+
+namespace mvgltools
+{
+#ifdef MVGLTOOLS_IO_URING
+    struct AsyncIO::Operation
+    {
+        enum class Stage
+        {
+            WAKE,
+            READ,
+            OPEN,
+            WRITE,
+            CLOSE,
+        };
+
+        Stage stage;
+        std::filesystem::path path;
+        std::vector<char> data;
+        uint64_t offset{0};
+        uint64_t transferred{0};
+        int fd{-1};
+        std::string error;
+        ReadCallback onRead;
+        WriteCallback onWrite;
+
+        /**
+         * Report the operation as failed to its callback, without touching its data or file descriptor.
+         */
+        void fail(const std::string& message) const
+        {
+            if (stage == Stage::READ)
+                onRead(std::unexpected(message));
+            else if (stage != Stage::WAKE)
+                onWrite(std::unexpected(message));
+        }
+    };
+
+    /**
+     * The memory shared with the kernel and the file descriptors owned by the I/O thread.
+     */
+    struct AsyncIO::Ring
+    {
+        int ringFd{-1};
+        int sourceFd{-1};
+        int wakeFd{-1};
+        uint32_t depth{0};
+
+        void* sqRing{nullptr};
+        size_t sqRingSize{0};
+        void* cqRing{nullptr};
+        size_t cqRingSize{0};
+        io_uring_sqe* sqes{nullptr};
+        size_t sqesSize{0};
+
+        uint32_t* sqHead{nullptr};
+        uint32_t* sqTail{nullptr};
+        uint32_t* sqArray{nullptr};
+        uint32_t sqMask{0};
+        uint32_t* cqHead{nullptr};
+        uint32_t* cqTail{nullptr};
+        io_uring_cqe* cqes{nullptr};
+        uint32_t cqMask{0};
+
+        Operation wake;
+        uint64_t wakeValue{0};
+        uint32_t inFlight{0};
+        /**
+         * Every operation that was handed to the kernel and didn't complete yet, except for the wake up.
+         */
+        std::unordered_set<Operation*> pending;
+
+        Ring() = default;
+        Ring(const Ring&)                    = delete;
+        auto operator=(const Ring&) -> Ring& = delete;
+
+        ~Ring()
+        {
+            if (sqes != nullptr) ::munmap(sqes, sqesSize);
+            if (cqRing != nullptr && cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+            if (sqRing != nullptr) ::munmap(sqRing, sqRingSize);
+            if (ringFd != -1) ::close(ringFd);
+            if (sourceFd != -1) ::close(sourceFd);
+            if (wakeFd != -1) ::close(wakeFd);
+        }
+
+        auto setup(const std::filesystem::path& source, uint32_t entries) -> bool
+        {
+            io_uring_params params{};
+            ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (ringFd < 0 || !supportsOperations(ringFd)) return false;
+
+            depth      = params.sq_entries;
+            sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+            cqRingSize = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+            sqesSize   = params.sq_entries * sizeof(io_uring_sqe);
+
+            const auto singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+            constexpr auto PROTECTION = PROT_READ | PROT_WRITE;
+            constexpr auto FLAGS      = MAP_SHARED | MAP_POPULATE;
+            auto* sqMap = ::mmap(nullptr, sqRingSize, PROTECTION, FLAGS, ringFd, IORING_OFF_SQ_RING);
+            if (sqMap == MAP_FAILED) return false;
+            sqRing = sqMap;
+
+            auto* cqMap =
+                singleMap ? sqMap : ::mmap(nullptr, cqRingSize, PROTECTION, FLAGS, ringFd, IORING_OFF_CQ_RING);
+            if (cqMap == MAP_FAILED) return false;
+            cqRing = cqMap;
+
+            auto* sqeMap = ::mmap(nullptr, sqesSize, PROTECTION, FLAGS, ringFd, IORING_OFF_SQES);
+            if (sqeMap == MAP_FAILED) return false;
+            sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+            sqHead  = offsetPointer<uint32_t>(sqRing, params.sq_off.head);
+            sqTail  = offsetPointer<uint32_t>(sqRing, params.sq_off.tail);
+            sqArray = offsetPointer<uint32_t>(sqRing, params.sq_off.array);
+            sqMask  = *offsetPointer<uint32_t>(sqRing, params.sq_off.ring_mask);
+            cqHead  = offsetPointer<uint32_t>(cqRing, params.cq_off.head);
+            cqTail  = offsetPointer<uint32_t>(cqRing, params.cq_off.tail);
+            cqes    = offsetPointer<io_uring_cqe>(cqRing, params.cq_off.cqes);
+            cqMask  = *offsetPointer<uint32_t>(cqRing, params.cq_off.ring_mask);
+
+            sourceFd   = ::open(source.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+            wakeFd     = ::eventfd(0, EFD_CLOEXEC);
+            wake.stage = Operation::Stage::WAKE;
+            return sourceFd != -1 && wakeFd != -1;
+        }
+
+        /**
+         * Queue the next step of an operation. Only called by the I/O thread, with less than depth operations in
+         * flight, so there's always room.
+         */
+        void prepare(Operation* operation)
+        {
+            const auto tail  = *sqTail;
+            const auto index = tail & sqMask;
+            auto& sqe        = sqes[index]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            auto remaining = std::min(operation->data.size() - operation->transferred, MAX_TRANSFER_SIZE);
+            auto* buffer   = operation->data.data() + operation->transferred;
+            switch (operation->stage)
+            {
+                case Operation::Stage::WAKE:
+                    sqe.opcode = IORING_OP_READ;
+                    sqe.fd     = wakeFd;
+                    sqe.addr   = reinterpret_cast<uint64_t>(&wakeValue);
+                    sqe.len    = sizeof(wakeValue);
+                    break;
+                case Operation::Stage::READ:
+                    sqe.opcode = IORING_OP_READ;
+                    sqe.fd     = sourceFd;
+                    sqe.addr   = reinterpret_cast<uint64_t>(buffer);
+                    sqe.len    = static_cast<uint32_t>(remaining);
+                    sqe.off    = operation->offset + operation->transferred;
+                    break;
+                case Operation::Stage::OPEN:
+                    sqe.opcode     = IORING_OP_OPENAT;
+                    sqe.fd         = AT_FDCWD;
+                    sqe.addr       = reinterpret_cast<uint64_t>(operation->path.c_str());
+                    sqe.len        = 0666; // NOLINT(readability-magic-numbers)
+                    sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                    break;
+                case Operation::Stage::WRITE:
+                    sqe.opcode = IORING_OP_WRITE;
+                    sqe.fd     = operation->fd;
+                    sqe.addr   = reinterpret_cast<uint64_t>(buffer);
+                    sqe.len    = static_cast<uint32_t>(remaining);
+                    sqe.off    = operation->transferred;
+                    break;
+                case Operation::Stage::CLOSE:
+                    sqe.opcode = IORING_OP_CLOSE;
+                    sqe.fd     = operation->fd;
+                    break;
+            }
+            sqe.user_data = reinterpret_cast<uint64_t>(operation);
+
+            sqArray[index] = index; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            storeRelease(sqTail, tail + 1);
+            inFlight++;
+            if (operation != &wake) pending.insert(operation);
+        }
+
+        /**
+         * Submit all prepared operations and wait for at least one of them to complete.
+         *
+         * @return 0, or the errno if the ring can't be used anymore
+         */
+        auto submitAndWait() -> int
+        {
+            const auto toSubmit = *sqTail - loadAcquire(sqHead);
+            auto result =
+                ::syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            // interrupted waits are simply repeated, the completion queue might have been full
+            if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return errno;
+            return 0;
+        }
+    };
+
+    auto AsyncIO::create(const std::filesystem::path& source, uint32_t depth) -> std::unique_ptr<AsyncIO>
+    {
+        auto ring = std::make_unique<Ring>();
+        if (!ring->setup(source, depth)) return nullptr;
+
+        return std::unique_ptr<AsyncIO>(new AsyncIO(std::move(ring)));
+    }
+
+    AsyncIO::AsyncIO(std::unique_ptr<Ring> ring)
+        : ring(std::move(ring))
+        , thread([this] { run(); })
+    {
+    }
+
+    AsyncIO::~AsyncIO()
+    {
+        {
+            const std::lock_guard lock(queueMutex);
+            stopping = true;
+        }
+        ::eventfd_write(ring->wakeFd, 1);
+        thread.join();
+    }
+
+    void AsyncIO::read(uint64_t offset, uint64_t size, ReadCallback done)
+    {
+        // the kernel would report an empty read as the end of the file
+        if (size == 0) return done(std::vector<char>());
+
+        auto operation    = std::make_unique<Operation>();
+        operation->stage  = Operation::Stage::READ;
+        operation->data   = std::vector<char>(size);
+        operation->offset = offset;
+        operation->onRead = std::move(done);
+        enqueue(std::move(operation));
+    }
+
+    void AsyncIO::writeFile(std::filesystem::path path, std::vector<char> data, WriteCallback done)
+    {
+        auto operation     = std::make_unique<Operation>();
+        operation->stage   = Operation::Stage::OPEN;
+        operation->path    = std::move(path);
+        operation->data    = std::move(data);
+        operation->onWrite = std::move(done);
+        enqueue(std::move(operation));
+    }
+
+    void AsyncIO::enqueue(std::unique_ptr<Operation> operation)
+    {
+        {
+            std::unique_lock lock(queueMutex);
+            if (!failure.empty())
+            {
+                const auto message = failure;
+                lock.unlock();
+                return operation->fail(message);
+            }
+            queue.push_back(std::move(operation));
+        }
+        // wakes the I/O thread up, if it's waiting for completions
+        ::eventfd_write(ring->wakeFd, 1);
+    }
+
+    void AsyncIO::run()
+    {
+        using enum Operation::Stage;
+
+        // the read of the eventfd is always in flight, so new operations wake up the thread
+        ring->prepare(&ring->wake);
+
+        std::deque<std::unique_ptr<Operation>> backlog;
+        while (true)
+        {
+            bool stop = false;
+            {
+                const std::lock_guard lock(queueMutex);
+                std::ranges::move(queue, std::back_inserter(backlog));
+                queue.clear();
+                stop = stopping && backlog.empty() && ring->inFlight == 1;
+            }
+            if (stop) break;
+
+            while (!backlog.empty() && ring->inFlight < ring->depth)
+            {
+                ring->prepare(backlog.front().release());
+                backlog.pop_front();
+            }
+
+            if (auto error = ring->submitAndWait(); error != 0) return fail(backlog, error);
+
+            // callbacks might queue new operations, those get picked up in the next iteration
+            auto head       = *ring->cqHead;
+            const auto tail = loadAcquire(ring->cqTail);
+            for (; head != tail; head++)
+            {
+                const auto& cqe = ring->cqes[head & ring->cqMask]; // NOLINT
+                auto* raw       = reinterpret_cast<Operation*>(cqe.user_data);
+                auto result     = cqe.res;
+                ring->inFlight--;
+
+                if (raw == &ring->wake)
+                {
+                    ring->prepare(raw);
+                    continue;
+                }
+
+                ring->pending.erase(raw);
+                std::unique_ptr<Operation> operation(raw);
+                switch (operation->stage)
+                {
+                    case READ:
+                        if (result <= 0)
+                        {
+                            auto error = result == 0 ? std::string("unexpected end of file") : errorString(result);
+                            operation->onRead(std::unexpected(std::format("Error: failed to read: {}", error)));
+                            continue;
+                        }
+                        operation->transferred += result;
+                        if (operation->transferred < operation->data.size())
+                        {
+                            ring->prepare(operation.release());
+                            continue;
+                        }
+                        operation->onRead(std::move(operation->data));
+                        continue;
+
+                    case OPEN:
+                        if (result < 0)
+                        {
+                            operation->onWrite(std::unexpected(std::format("Error: failed to create {}: {}",
+                                                                           operation->path.string(),
+                                                                           errorString(result))));
+                            continue;
+                        }
+                        operation->fd    = result;
+                        operation->stage = operation->data.empty() ? CLOSE : WRITE;
+                        ring->prepare(operation.release());
+                        continue;
+
+                    case WRITE:
+                        if (result <= 0)
+                        {
+                            auto error       = result == 0 ? std::string("nothing written") : errorString(result);
+                            operation->error = std::format("Error: failed to write {}: {}",
+                                                           operation->path.string(),
+                                                           error);
+                            operation->stage = CLOSE;
+                        }
+                        else if ((operation->transferred += result) == operation->data.size())
+                            operation->stage = CLOSE;
+
+                        ring->prepare(operation.release());
+                        continue;
+
+                    case CLOSE:
+                        if (operation->error.empty())
+                            operation->onWrite({});
+                        else
+                            operation->onWrite(std::unexpected(operation->error));
+                        continue;
+
+                    case WAKE: continue;
+                }
+            }
+            storeRelease(ring->cqHead, head);
+        }
+    }
+
+    void AsyncIO::fail(std::deque<std::unique_ptr<Operation>>& backlog, int error)
+    {
+        const auto message = std::format("Error: asynchronous I/O failed: {}", errorString(-error));
+
+        // operations queued from now on fail right away, on the calling thread
+        {
+            const std::lock_guard lock(queueMutex);
+            failure = message;
+            std::ranges::move(queue, std::back_inserter(backlog));
+            queue.clear();
+        }
+
+        for (const auto& operation : backlog)
+            operation->fail(message);
+        backlog.clear();
+
+        // the kernel might still access the operations it was given, so they're leaked rather than freed
+        for (auto* operation : ring->pending)
+            operation->fail(message);
+        ring->pending.clear();
+    }
+#else
+    struct AsyncIO::Operation
+    {
+    };
+
+    struct AsyncIO::Ring
+    {
+    };
+
+    auto AsyncIO::create(const std::filesystem::path& /*source*/, uint32_t /*depth*/) -> std::unique_ptr<AsyncIO>
+    {
+        return nullptr;
+    }
+
+    AsyncIO::AsyncIO(std::unique_ptr<Ring> ring)
+        : ring(std::move(ring))
+    {
+    }
+
+    AsyncIO::~AsyncIO() = default;
+
+    void AsyncIO::read(uint64_t /*offset*/, uint64_t /*size*/, ReadCallback done)
+    {
+        done(std::unexpected("Error: asynchronous I/O is not supported."));
+    }
+
+    void AsyncIO::writeFile(std::filesystem::path /*path*/, std::vector<char> /*data*/, WriteCallback done)
+    {
+        done(std::unexpected("Error: asynchronous I/O is not supported."));
+    }
+
+    void AsyncIO::enqueue(std::unique_ptr<Operation> /*operation*/) {}
+
+    void AsyncIO::run() {}
+
+    void AsyncIO::fail(std::deque<std::unique_ptr<Operation>>& /*backlog*/, int /*error*/) {}
+#endif
+} // namespace mvgltools
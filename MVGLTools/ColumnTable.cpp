@@ -0,0 +1,218 @@
+#include "ColumnTable.h"
+
+#include "EXPA.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace
+{
+    using namespace mvgltools::expa;
+
+    constexpr uint64_t MAX_OFFSET = std::numeric_limits<uint32_t>::max();
+
+    template<typename... Ts>
+    struct Overloaded : Ts...
+    {
+        using Ts::operator()...;
+    };
+
+    auto makeColumn(EntryType type) -> Column
+    {
+        switch (type)
+        {
+            case EntryType::BOOL: return std::vector<uint8_t>{};
+            case EntryType::INT8: return std::vector<int8_t>{};
+            case EntryType::INT16: return std::vector<int16_t>{};
+            case EntryType::INT32: return std::vector<int32_t>{};
+            case EntryType::FLOAT: return std::vector<float>{};
+
+            case EntryType::STRING3: [[fallthrough]];
+            case EntryType::STRING: [[fallthrough]];
+            case EntryType::STRING2: return std::vector<StringRef>{};
+
+            case EntryType::INT32_ARRAY: return ArrayColumn{};
+
+            case EntryType::EMPTY: [[fallthrough]];
+            case EntryType::UNK1: [[fallthrough]];
+            default: return std::monostate{};
+        }
+    }
+} // namespace
+
+namespace mvgltools::expa
+{
+    ColumnTable::ColumnTable(std::string name, Structure structure)
+        : name(std::move(name))
+        , structure(std::move(structure))
+    {
+        for (const auto& entry : this->structure.getStructure())
+            columns.push_back(makeColumn(entry.type));
+    }
+
+    auto ColumnTable::fromTable(const Table& table) -> ColumnTable
+    {
+        ColumnTable result(table.name, table.structure);
+        for (const auto& row : table.entries)
+            result.addRow(row);
+
+        return result;
+    }
+
+    auto ColumnTable::toTable() const -> Table
+    {
+        std::vector<std::vector<EntryValue>> entries;
+        entries.reserve(rowCount);
+        for (size_t i = 0; i < rowCount; i++)
+            entries.push_back(getRow(i));
+
+        return {.name = name, .structure = structure, .entries = std::move(entries)};
+    }
+
+    auto ColumnTable::getName() const -> const std::string&
+    {
+        return name;
+    }
+
+    auto ColumnTable::getStructure() const -> const Structure&
+    {
+        return structure;
+    }
+
+    auto ColumnTable::getRowCount() const -> size_t
+    {
+        return rowCount;
+    }
+
+    auto ColumnTable::getColumnCount() const -> size_t
+    {
+        return columns.size();
+    }
+
+    void ColumnTable::addRow(const std::vector<EntryValue>& row)
+    {
+        if (row.size() < columns.size())
+            throw std::invalid_argument(std::format("Row has {} values, expected {}.", row.size(), columns.size()));
+
+        // check all values first, so a mismatch doesn't leave the columns with different lengths
+        uint64_t stringSize = strings.size();
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            const auto& value = row[i];
+
+            auto matches = Overloaded{
+                [](const std::monostate&) { return true; },
+                [&](const std::vector<uint8_t>&) { return std::holds_alternative<bool>(value); },
+                [&]<typename T>(const std::vector<T>&) { return std::holds_alternative<T>(value); },
+                [&](const std::vector<StringRef>&) { return std::holds_alternative<std::string>(value); },
+                [&](const ArrayColumn&) { return std::holds_alternative<std::vector<int32_t>>(value); },
+            };
+
+            if (!std::visit(matches, columns[i]))
+                throw std::invalid_argument(std::format("Value {} of the row has the wrong type.", i));
+
+            // string and array offsets are stored as 32 bit
+            const auto* str = std::get_if<std::string>(&value);
+            if (str != nullptr && std::holds_alternative<std::vector<StringRef>>(columns[i])) stringSize += str->size();
+            const auto* array  = std::get_if<ArrayColumn>(&columns[i]);
+            const auto* values = std::get_if<std::vector<int32_t>>(&value);
+            if (array != nullptr && values != nullptr && array->values.size() + values->size() > MAX_OFFSET)
+                throw std::length_error(std::format("Column {} exceeds the maximum array size.", i));
+        }
+        if (stringSize > MAX_OFFSET) throw std::length_error("The row exceeds the maximum string size of the table.");
+
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            const auto& value = row[i];
+
+            auto visitor = Overloaded{
+                [](std::monostate&) {},
+                [&](std::vector<uint8_t>& column) { column.push_back(std::get<bool>(value) ? 1 : 0); },
+                [&]<typename T>(std::vector<T>& column) { column.push_back(std::get<T>(value)); },
+                [&](std::vector<StringRef>& column)
+                {
+                    const auto& str = std::get<std::string>(value);
+                    column.push_back({static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size())});
+                    strings.append(str);
+                },
+                [&](ArrayColumn& column)
+                {
+                    const auto& array = std::get<std::vector<int32_t>>(value);
+                    column.values.insert(column.values.end(), array.begin(), array.end());
+                    column.offsets.push_back(static_cast<uint32_t>(column.values.size()));
+                },
+            };
+
+            std::visit(visitor, columns[i]);
+        }
+
+        rowCount++;
+    }
+
+    auto ColumnTable::getRow(size_t row) const -> std::vector<EntryValue>
+    {
+        std::vector<EntryValue> values;
+        values.reserve(columns.size());
+        for (size_t i = 0; i < columns.size(); i++)
+            values.push_back(getValue(row, i));
+
+        return values;
+    }
+
+    auto ColumnTable::getValue(size_t row, size_t column) const -> EntryValue
+    {
+        auto visitor = Overloaded{
+            [](const std::monostate&) -> EntryValue { return std::nullopt; },
+            [&](const std::vector<uint8_t>& data) -> EntryValue { return data.at(row) != 0; },
+            [&]<typename T>(const std::vector<T>& data) -> EntryValue { return data.at(row); },
+            [&](const std::vector<StringRef>&) -> EntryValue { return std::string(getString(row, column)); },
+            [&](const ArrayColumn&) -> EntryValue
+            {
+                auto array = getArray(row, column);
+                return std::vector<int32_t>(array.begin(), array.end());
+            },
+        };
+
+        return std::visit(visitor, columns.at(column));
+    }
+
+    auto ColumnTable::getString(size_t row, size_t column) const -> std::string_view
+    {
+        auto ref = std::get<std::vector<StringRef>>(columns.at(column)).at(row);
+        return std::string_view(strings).substr(ref.offset, ref.size);
+    }
+
+    auto ColumnTable::getArray(size_t row, size_t column) const -> std::span<const int32_t>
+    {
+        const auto& data = std::get<ArrayColumn>(columns.at(column));
+        auto start       = data.offsets.at(row);
+        auto end         = data.offsets.at(row + 1);
+        return std::span(data.values).subspan(start, end - start);
+    }
+
+    auto ColumnTable::getMemoryUsage() const -> size_t
+    {
+        auto visitor = Overloaded{
+            [](const std::monostate&) -> size_t { return 0; },
+            []<typename T>(const std::vector<T>& data) -> size_t { return data.capacity() * sizeof(T); },
+            [](const ArrayColumn& data) -> size_t
+            { return (data.offsets.capacity() * sizeof(uint32_t)) + (data.values.capacity() * sizeof(int32_t)); },
+        };
+
+        size_t size = strings.capacity();
+        for (const auto& column : columns)
+            size += std::visit(visitor, column);
+
+        return size;
+    }
+} // namespace mvgltools::expa
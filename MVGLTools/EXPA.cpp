@@ -1,5 +1,6 @@
 #include "EXPA.h"
 
+#include "ColumnTable.h"
 #include "Helpers.h"
 
 #include <boost/property_tree/json_parser.hpp>
@@ -7,22 +8,34 @@
 #include <boost/regex.hpp>
 #include <boost/regex/v5/regex_fwd.hpp>
 #include <boost/regex/v5/regex_search.hpp>
-#include <parser.hpp>
 
 #include <algorithm>
+#include <array>
 #include <bitset>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <expected>
 #include <filesystem>
 #include <format>
 #include <fstream>
-#include <iomanip>
+#include <functional>
 #include <ios>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <ostream>
 #include <ranges>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -70,63 +83,71 @@ namespace
         }
     }
 
-    auto getCSVString(const EntryType& type, const EntryValue& value) -> std::string
+    constexpr auto trimSpaces(std::string_view value) -> std::string_view
     {
-        switch (type)
-        {
-            case EntryType::INT32: return std::format("{}", std::get<int32_t>(value));
-            case EntryType::INT16: return std::format("{}", std::get<int16_t>(value));
-            case EntryType::INT8: return std::format("{}", std::get<int8_t>(value));
-            case EntryType::FLOAT: return std::format("{}", std::get<float>(value));
-            case EntryType::BOOL: return std::format("{}", std::get<bool>(value));
+        auto start = value.find_first_not_of(" \t");
+        if (start == std::string_view::npos) return {};
+        auto end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
 
-            case EntryType::STRING3: [[fallthrough]];
-            case EntryType::STRING: [[fallthrough]];
-            case EntryType::STRING2:
-            {
-                std::stringstream sstream;
-                sstream << std::quoted(std::get<std::string>(value), '\"', '\"');
-                return sstream.str();
-            }
-            case EntryType::INT32_ARRAY:
-            {
-                auto data = std::get<std::vector<int32_t>>(value) |
-                            std::views::transform([](auto val) { return std::to_string(val); });
-                return std::views::join_with(data, ' ') | std::ranges::to<std::string>();
-            }
-            case EntryType::EMPTY: [[fallthrough]];
-            case EntryType::UNK1: [[fallthrough]];
-            default: return "";
-        }
+    template<typename T>
+    auto parseNumber(std::string_view value) -> std::optional<T>
+    {
+        value = trimSpaces(value);
+        if (value.starts_with('+')) value.remove_prefix(1);
+
+        T result{};
+        const auto* end    = value.data() + value.size();
+        auto [ptr, errc] = std::from_chars(value.data(), end, result);
+        if (errc != std::errc{} || ptr != end || value.empty()) return std::nullopt;
+
+        return result;
     }
 
-    auto getCSVValue(const EntryType& type, const std::string& value) -> EntryValue
+    auto getCSVValue(const EntryType& type, std::string_view value) -> std::optional<EntryValue>
     {
         switch (type)
         {
             default:
             case EntryType::UNK1: [[fallthrough]];
-            case EntryType::EMPTY: return std::nullopt;
+            case EntryType::EMPTY: return EntryValue{std::nullopt};
 
-            case EntryType::INT32: return std::stoi(value);
-            case EntryType::INT16: return static_cast<int16_t>(std::stoi(value));
-            case EntryType::INT8: return static_cast<int8_t>(std::stoi(value));
-            case EntryType::FLOAT: return std::stof(value);
+            case EntryType::INT32: return parseNumber<int32_t>(value);
+            case EntryType::INT16:
+                return parseNumber<int32_t>(value).transform([](auto val) { return static_cast<int16_t>(val); });
+            case EntryType::INT8:
+                return parseNumber<int32_t>(value).transform([](auto val) { return static_cast<int8_t>(val); });
+            case EntryType::FLOAT: return parseNumber<float>(value);
 
             case EntryType::STRING3: [[fallthrough]];
             case EntryType::STRING: [[fallthrough]];
-            case EntryType::STRING2: return value;
+            case EntryType::STRING2: return std::string(value);
 
             case EntryType::BOOL: return value == "true";
             case EntryType::INT32_ARRAY:
-                return value | std::views::split(' ') | std::ranges::to<std::vector<std::string>>() |
-                       std::views::transform([](const auto& val) { return std::stoi(val); }) |
-                       std::ranges::to<std::vector<int32_t>>();
+            {
+                std::vector<int32_t> values;
+                for (auto val : value | std::views::split(' '))
+                {
+                    if (val.empty()) continue;
+
+                    auto number = parseNumber<int32_t>(std::string_view(val.begin(), val.end()));
+                    if (!number) return std::nullopt;
+                    values.push_back(number.value());
+                }
+                return values;
+            }
         }
     }
 
-    auto writeEXPAEntry(size_t base_offset, char* data, EntryType type, const EntryValue& value)
-        -> std::optional<CHNKEntry>
+    constexpr auto getCHNKStringSize(size_t length) -> uint32_t
+    {
+        return static_cast<uint32_t>(ceilInteger(static_cast<int64_t>(length + 2), 4));
+    }
+
+    auto writeEXPAEntry(uint32_t base_offset, char* data, EntryType type, const EntryValue& value)
+        -> std::optional<CHNKReference>
     {
         switch (type)
         {
@@ -140,8 +161,8 @@ namespace
             case EntryType::STRING2:
             {
                 *reinterpret_cast<uint64_t*>(data) = 0;
-                auto str                           = get<std::string>(value);
-                if (!str.empty()) return CHNKEntry(base_offset, str);
+                const auto& str                    = get<std::string>(value);
+                if (!str.empty()) return CHNKReference{base_offset, str, getCHNKStringSize(str.size())};
                 break;
             }
             case EntryType::INT32_ARRAY:
@@ -149,8 +170,10 @@ namespace
                 const auto& array                      = get<std::vector<int32_t>>(value);
                 *reinterpret_cast<uint32_t*>(data)     = static_cast<int32_t>(array.size());
                 *reinterpret_cast<uint64_t*>(data + 8) = 0;
-                if (!array.empty()) return CHNKEntry(base_offset + 8, array);
-                break;
+                if (array.empty()) break;
+
+                const auto size = static_cast<uint32_t>(array.size() * sizeof(int32_t));
+                return CHNKReference{base_offset + 8, {reinterpret_cast<const char*>(array.data()), size}, size};
             }
 
             case EntryType::EMPTY: [[fallthrough]];
@@ -161,7 +184,84 @@ namespace
         return std::nullopt;
     }
 
-    auto readEXPAEntry(EntryType type, const char* data, uint32_t bitCounter) -> EntryValue
+    /**
+     * Walk the EXPA layout of a structure, calling func with the type, offset and bit index of every entry.
+     */
+    template<typename Func>
+    void forEachEXPAEntry(const std::vector<StructureEntry>& structure, Func&& func)
+    {
+        auto offset     = 0u;
+        auto bitCounter = 0u;
+
+        for (const auto& val : structure)
+        {
+            if (val.type != EntryType::BOOL || bitCounter >= 32)
+            {
+                if (bitCounter > 0) offset += getSize(EntryType::BOOL);
+
+                offset     = ceilInteger(offset, getAlignment(val.type));
+                bitCounter = 0;
+            }
+
+            func(val.type, offset, bitCounter);
+
+            if (val.type == EntryType::BOOL)
+                bitCounter++;
+            else
+                offset += getSize(val.type);
+        }
+    }
+
+    /**
+     * Get the string a pointer field refers to, up to its terminator.
+     */
+    auto readCHNKString(const CHNKLookup& chunks, const char* field) -> std::string_view
+    {
+        auto value = chunks.find(field);
+        return {value.data(), std::ranges::find(value, '\0') - value.begin()};
+    }
+
+    /**
+     * Get the int32 array a pointer field refers to, limited to the data actually present.
+     */
+    auto readCHNKArray(const CHNKLookup& chunks, const char* field, int32_t count) -> std::vector<int32_t>
+    {
+        auto value = chunks.find(field);
+        if (count <= 0) return {};
+
+        std::vector<int32_t> values(std::min<size_t>(count, value.size() / sizeof(int32_t)));
+        std::memcpy(values.data(), value.data(), values.size() * sizeof(int32_t));
+        return values;
+    }
+
+    void writeCSVEntry(CSVWriter& writer,
+                       const CHNKLookup& chunks,
+                       EntryType type,
+                       const char* data,
+                       uint32_t bitCounter)
+    {
+        switch (type)
+        {
+            case EntryType::INT32: writer.writeInteger(readAt<int32_t>(data, 0)); break;
+            case EntryType::INT16: writer.writeInteger(readAt<int16_t>(data, 0)); break;
+            case EntryType::INT8: writer.writeInteger(readAt<int8_t>(data, 0)); break;
+            case EntryType::FLOAT: writer.writeFloat(readAt<float>(data, 0)); break;
+            case EntryType::BOOL: writer.writeBool(((readAt<uint32_t>(data, 0) >> bitCounter) & 1u) == 1u); break;
+
+            case EntryType::STRING3: [[fallthrough]];
+            case EntryType::STRING: [[fallthrough]];
+            case EntryType::STRING2: writer.writeString(readCHNKString(chunks, data)); break;
+            case EntryType::INT32_ARRAY:
+                writer.writeIntArray(readCHNKArray(chunks, data + 8, readAt<int32_t>(data, 0)));
+                break;
+
+            case EntryType::EMPTY: [[fallthrough]];
+            case EntryType::UNK1: [[fallthrough]];
+            default: writer.writeField(""); break;
+        }
+    }
+
+    auto readEXPAEntry(const CHNKLookup& chunks, EntryType type, const char* data, uint32_t bitCounter) -> EntryValue
     {
         switch (type)
         {
@@ -175,21 +275,10 @@ namespace
             case EntryType::FLOAT: return *reinterpret_cast<const float*>(data);
             case EntryType::STRING3: [[fallthrough]];
             case EntryType::STRING: [[fallthrough]];
-            case EntryType::STRING2:
-            {
-                auto* ptr = *reinterpret_cast<char* const*>(data);
-                return (ptr != nullptr) ? std::string(ptr) : "";
-            }
+            case EntryType::STRING2: return std::string(readCHNKString(chunks, data));
             case EntryType::BOOL: return ((*reinterpret_cast<const uint32_t*>(data) >> bitCounter) & 1u) == 1u;
             case EntryType::INT32_ARRAY:
-            {
-                auto count = *reinterpret_cast<const int32_t*>(data);
-                auto* ptr  = *reinterpret_cast<int32_t* const*>(data + 8);
-                std::vector<int32_t> values;
-                for (int32_t i = 0; i < count; i++)
-                    values.push_back(ptr[i]);
-                return values;
-            }
+                return readCHNKArray(chunks, data + 8, *reinterpret_cast<const int32_t*>(data));
         }
     }
 
@@ -208,23 +297,34 @@ namespace mvgltools::expa
     }
 
     auto Structure::writeEXPA(const std::vector<EntryValue>& entries) const -> EXPAEntry
+    {
+        std::vector<char> data(getEXPASize(), '\xCC');
+        std::vector<CHNKReference> chunk;
+        writeEXPA(entries, data.data(), 0, chunk);
+
+        return {.data  = data,
+                .chunk = chunk | std::views::transform([](const auto& val) { return CHNKEntry(val); }) |
+                         std::ranges::to<std::vector<CHNKEntry>>()};
+    }
+
+    void Structure::writeEXPA(const std::vector<EntryValue>& entries,
+                              char* data,
+                              uint32_t baseOffset,
+                              std::vector<CHNKReference>& chunk) const
     {
         auto offset     = 0u;
         auto bitCounter = 0;
         std::bitset<32> currentBool;
-        std::vector<CHNKEntry> chunkEntries;
-        std::vector<char> new_data(getEXPASize(), '\xCC');
 
-        for (const auto& val : std::views::zip(structure, entries))
+        for (const auto& [structureEntry, entry] : std::views::zip(structure, entries))
         {
-            auto type  = get<0>(val).type;
-            auto entry = get<1>(val);
+            auto type = structureEntry.type;
 
             if (type != EntryType::BOOL || bitCounter >= 32)
             {
                 if (bitCounter > 0)
                 {
-                    *reinterpret_cast<uint32_t*>(new_data.data() + offset) = currentBool.to_ulong();
+                    *reinterpret_cast<uint32_t*>(data + offset) = currentBool.to_ulong();
                     offset += sizeof(uint32_t);
                     bitCounter  = 0;
                     currentBool = {};
@@ -232,8 +332,8 @@ namespace mvgltools::expa
                 offset = ceilInteger(offset, getAlignment(type));
             }
 
-            auto result = writeEXPAEntry(offset, new_data.data() + offset, type, entry);
-            if (result) chunkEntries.push_back(result.value());
+            auto result = writeEXPAEntry(baseOffset + offset, data + offset, type, entry);
+            if (result) chunk.push_back(result.value());
 
             if (type == EntryType::BOOL)
                 currentBool.set(bitCounter++, get<bool>(entry));
@@ -241,46 +341,94 @@ namespace mvgltools::expa
                 offset += getSize(type);
         }
 
-        if (bitCounter > 0) *reinterpret_cast<uint32_t*>(new_data.data() + offset) = currentBool.to_ulong();
-
-        return {.data = new_data, .chunk = chunkEntries};
+        if (bitCounter > 0) *reinterpret_cast<uint32_t*>(data + offset) = currentBool.to_ulong();
     }
 
-    auto Structure::readEXPA(const char* data) const -> std::vector<EntryValue>
+    auto Structure::getCHNKSize(const std::vector<EntryValue>& entries) const -> std::pair<uint32_t, size_t>
     {
-        if (structure.empty()) return {};
+        uint32_t count = 0;
+        size_t size    = 0;
 
-        std::vector<EntryValue> values;
-        auto offset     = 0u;
-        auto bitCounter = 0u;
-
-        for (const auto& val : structure)
+        for (const auto& [structureEntry, entry] : std::views::zip(structure, entries))
         {
-            if (val.type != EntryType::BOOL || bitCounter >= 32)
+            switch (structureEntry.type)
             {
-                if (bitCounter > 0) offset += getSize(EntryType::BOOL);
+                case EntryType::STRING3: [[fallthrough]];
+                case EntryType::STRING: [[fallthrough]];
+                case EntryType::STRING2:
+                {
+                    const auto& str = get<std::string>(entry);
+                    if (str.empty()) break;
 
-                offset     = ceilInteger(offset, getAlignment(val.type));
-                bitCounter = 0;
+                    count++;
+                    size += (2 * sizeof(uint32_t)) + getCHNKStringSize(str.size());
+                    break;
+                }
+                case EntryType::INT32_ARRAY:
+                {
+                    const auto& array = get<std::vector<int32_t>>(entry);
+                    if (array.empty()) break;
+
+                    count++;
+                    size += (2 * sizeof(uint32_t)) + (array.size() * sizeof(int32_t));
+                    break;
+                }
+                default: break;
             }
+        }
 
-            values.push_back(readEXPAEntry(val.type, data + offset, bitCounter));
+        return {count, size};
+    }
 
-            if (val.type == EntryType::BOOL)
-                bitCounter++;
-            else
-                offset += getSize(val.type);
-        }
+    auto Structure::readEXPA(const char* data, const CHNKLookup& chunks) const -> std::vector<EntryValue>
+    {
+        if (structure.empty()) return {};
+
+        std::vector<EntryValue> values;
+        values.reserve(structure.size());
+
+        forEachEXPAEntry(structure,
+                         [&](auto type, auto offset, auto bitCounter)
+                         { values.push_back(readEXPAEntry(chunks, type, data + offset, bitCounter)); });
 
         return values;
     }
 
     auto Structure::readCSV(const std::vector<std::string>& data) const -> std::vector<EntryValue>
     {
-        return std::views::zip_transform([](const auto& val, const auto& val2) { return getCSVValue(val.type, val2); },
-                                         structure,
-                                         data) |
-               std::ranges::to<std::vector<EntryValue>>();
+        auto views  = data | std::views::transform([](const auto& val) { return std::string_view(val); }) |
+                     std::ranges::to<std::vector<std::string_view>>();
+        auto result = readCSV(views);
+        if (!result) throw std::invalid_argument(result.error());
+
+        return result.value();
+    }
+
+    auto Structure::readCSV(std::span<const std::string_view> data) const
+        -> std::expected<std::vector<EntryValue>, std::string>
+    {
+        if (data.size() < structure.size())
+            return std::unexpected(std::format("expected {} fields, found {}", structure.size(), data.size()));
+
+        std::vector<EntryValue> values;
+        values.reserve(structure.size());
+
+        for (size_t i = 0; i < structure.size(); i++)
+        {
+            const auto& entry = structure[i];
+            auto value = getCSVValue(entry.type, data[i]);
+            if (!value)
+            {
+                return std::unexpected(std::format("column {} ({}): invalid {} value '{}'",
+                                                   i + 1,
+                                                   entry.name,
+                                                   detail::toString(entry.type),
+                                                   data[i]));
+            }
+            values.push_back(std::move(value.value()));
+        }
+
+        return values;
     }
 
     auto Structure::getCSVHeader() const -> std::string
@@ -291,15 +439,38 @@ namespace mvgltools::expa
 
     auto Structure::writeCSV(const std::vector<EntryValue>& entries) const -> std::string
     {
-        std::stringstream stream;
-        auto result = structure | std::views::transform([](const auto& val) { return val.name; }) |
-                      std::views::join_with(',') | std::ranges::to<std::string>();
-        stream << result << "\n";
+        std::ostringstream stream;
+        {
+            CSVWriter writer(stream);
+            writeCSV(entries, writer);
+        }
 
-        return std::views::zip_transform([](const auto& val, const auto& val2) { return getCSVString(val.type, val2); },
-                                         structure,
-                                         entries) |
-               std::views::join_with(',') | std::ranges::to<std::string>();
+        // the row is returned without its line break, callers add their own
+        auto row = stream.str();
+        if (row.ends_with('\n')) row.pop_back();
+        return row;
+    }
+
+    void Structure::writeCSVHeader(CSVWriter& writer) const
+    {
+        for (const auto& entry : structure)
+            writer.writeField(entry.name);
+        writer.endRow();
+    }
+
+    void Structure::writeCSV(const std::vector<EntryValue>& entries, CSVWriter& writer) const
+    {
+        for (const auto& [entry, value] : std::views::zip(structure, entries))
+            writer.writeValue(entry.type, value);
+        writer.endRow();
+    }
+
+    void Structure::writeCSV(const char* data, const CHNKLookup& chunks, CSVWriter& writer) const
+    {
+        forEachEXPAEntry(structure,
+                         [&](auto type, auto offset, auto bitCounter)
+                         { writeCSVEntry(writer, chunks, type, data + offset, bitCounter); });
+        writer.endRow();
     }
 
     auto Structure::getEXPASize() const -> uint32_t
@@ -332,10 +503,17 @@ namespace mvgltools::expa
     CHNKEntry::CHNKEntry(uint32_t offset, const std::string& data)
         : offset(offset)
     {
-        value = std::vector<char>(ceilInteger(static_cast<int64_t>(data.size() + 2), 4));
+        value = std::vector<char>(getCHNKStringSize(data.size()));
         std::ranges::copy(data, value.begin());
     }
 
+    CHNKEntry::CHNKEntry(const CHNKReference& reference)
+        : offset(reference.offset)
+        , value(reference.size)
+    {
+        std::ranges::copy(reference.value, value.begin());
+    }
+
     CHNKEntry::CHNKEntry(uint32_t offset, const std::vector<int32_t>& data)
         : offset(offset)
     {
@@ -343,6 +521,465 @@ namespace mvgltools::expa
         std::copy_n(reinterpret_cast<const char*>(data.data()), value.size(), value.begin());
     }
 
+    auto StructureRegistry::get(std::string_view folder) -> const StructureRegistry&
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::unique_ptr<StructureRegistry>, std::less<>> registries;
+
+        const std::scoped_lock lock(mutex);
+
+        auto itr = registries.find(folder);
+        if (itr == registries.end())
+            itr = registries.emplace(folder, std::make_unique<StructureRegistry>(std::filesystem::path(folder))).first;
+
+        return *itr->second;
+    }
+
+    StructureRegistry::StructureRegistry(const std::filesystem::path& folder)
+    {
+        const auto structureFile = folder / "structure.json";
+
+        if (!std::filesystem::is_directory(folder)) return;
+        if (!std::filesystem::exists(structureFile)) return;
+
+        boost::property_tree::ptree structure;
+        boost::property_tree::read_json(structureFile.string(), structure);
+
+        auto loadDefinition = [&](const std::string& formatFile) -> Definition
+        {
+            boost::property_tree::ptree format;
+            try
+            {
+                boost::property_tree::read_json((folder / formatFile).string(), format);
+            }
+            catch (boost::property_tree::json_parser_error& ex)
+            {
+                return std::unexpected(ex.what());
+            }
+
+            std::vector<TableDefinition> tables;
+            for (const auto& [name, value] : format)
+            {
+                // tables with an invalid pattern can still be matched by their exact name
+                boost::regex pattern{wrapRegex(name), boost::regex::no_except};
+                if (pattern.status() != 0)
+                    log(std::format("Warning: invalid table pattern '{}' in {}, only exact names match it.",
+                                    name,
+                                    (folder / formatFile).string()));
+
+                std::vector<StructureEntry> entries;
+                for (const auto& val : value)
+                    entries.emplace_back(val.first, convertEntryType(val.second.data()));
+
+                tables.emplace_back(name,
+                                    pattern.status() == 0 ? std::optional{pattern} : std::nullopt,
+                                    std::move(entries));
+            }
+
+            return tables;
+        };
+
+        for (const auto& [key, value] : structure)
+        {
+            boost::regex pattern{key, boost::regex::no_except};
+            if (pattern.status() != 0)
+            {
+                log(std::format("Warning: invalid file pattern '{}' in {} is ignored.", key, structureFile.string()));
+                continue;
+            }
+
+            const auto& formatFile = value.data();
+            auto itr               = definitions.find(formatFile);
+            if (itr == definitions.end()) itr = definitions.emplace(formatFile, loadDefinition(formatFile)).first;
+
+            files.emplace_back(std::move(pattern), &itr->second);
+        }
+    }
+
+    auto StructureRegistry::find(const std::filesystem::path& filePath, const std::string& tableName) const
+        -> std::vector<StructureEntry>
+    {
+        CacheKey key{filePath.string(), tableName};
+
+        {
+            const std::shared_lock lock(cacheMutex);
+            auto itr = cache.find(key);
+            if (itr != cache.end()) return itr->second;
+        }
+
+        auto result = lookup(filePath, tableName);
+
+        const std::unique_lock lock(cacheMutex);
+        cache.emplace(std::move(key), result);
+        return result;
+    }
+
+    auto StructureRegistry::lookup(const std::filesystem::path& filePath, const std::string& tableName) const
+        -> std::vector<StructureEntry>
+    {
+        const auto path = filePath.string();
+        auto file = std::ranges::find_if(files, [&](const auto& val) { return boost::regex_search(path, val.first); });
+        if (file == files.end()) return {};
+
+        const auto& definition = *file->second;
+        if (!definition) throw std::runtime_error(definition.error());
+
+        // exact matches have priority, otherwise scan all table definitions to find a matching regex expression
+        auto table = std::ranges::find(definition.value(), tableName, &TableDefinition::name);
+        if (table == definition->end())
+        {
+            auto matches = [&](const auto& val)
+            { return val.pattern && boost::regex_search(tableName, val.pattern.value()); };
+            table = std::ranges::find_if(definition.value(), matches);
+        }
+        if (table == definition->end()) return {};
+
+        return table->structure;
+    }
+
+    CSVWriter::CSVWriter(std::ostream& stream, size_t flushSize)
+        : stream(stream)
+        , flushSize(flushSize)
+    {
+        buffer.reserve(flushSize + (flushSize / 4));
+    }
+
+    CSVWriter::~CSVWriter()
+    {
+        flush();
+    }
+
+    void CSVWriter::separate()
+    {
+        if (!firstField) buffer.push_back(',');
+        firstField = false;
+    }
+
+    void CSVWriter::writeField(std::string_view value)
+    {
+        separate();
+        buffer.append(value);
+    }
+
+    void CSVWriter::writeString(std::string_view value)
+    {
+        separate();
+        buffer.push_back('"');
+
+        auto pos = value.find('"');
+        while (pos != std::string_view::npos)
+        {
+            buffer.append(value.substr(0, pos + 1));
+            buffer.push_back('"');
+            value = value.substr(pos + 1);
+            pos   = value.find('"');
+        }
+
+        buffer.append(value);
+        buffer.push_back('"');
+    }
+
+    void CSVWriter::writeFloat(float value)
+    {
+        std::array<char, 32> data{};
+        auto result = std::to_chars(data.data(), data.data() + data.size(), value);
+        writeField({data.data(), result.ptr});
+    }
+
+    void CSVWriter::writeBool(bool value)
+    {
+        writeField(value ? "true" : "false");
+    }
+
+    void CSVWriter::writeIntArray(std::span<const int32_t> values)
+    {
+        separate();
+
+        std::array<char, 16> data{};
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (i != 0) buffer.push_back(' ');
+            auto result = std::to_chars(data.data(), data.data() + data.size(), values[i]);
+            buffer.append(data.data(), result.ptr);
+        }
+    }
+
+    void CSVWriter::writeValue(EntryType type, const EntryValue& value)
+    {
+        switch (type)
+        {
+            case EntryType::INT32: writeInteger(std::get<int32_t>(value)); break;
+            case EntryType::INT16: writeInteger(std::get<int16_t>(value)); break;
+            case EntryType::INT8: writeInteger(std::get<int8_t>(value)); break;
+            case EntryType::FLOAT: writeFloat(std::get<float>(value)); break;
+            case EntryType::BOOL: writeBool(std::get<bool>(value)); break;
+
+            case EntryType::STRING3: [[fallthrough]];
+            case EntryType::STRING: [[fallthrough]];
+            case EntryType::STRING2: writeString(std::get<std::string>(value)); break;
+
+            case EntryType::INT32_ARRAY: writeIntArray(std::get<std::vector<int32_t>>(value)); break;
+
+            case EntryType::EMPTY: [[fallthrough]];
+            case EntryType::UNK1: [[fallthrough]];
+            default: writeField(""); break;
+        }
+    }
+
+    void CSVWriter::endRow()
+    {
+        buffer.push_back('\n');
+        firstField = true;
+
+        if (buffer.size() >= flushSize) flush();
+    }
+
+    void CSVWriter::flush()
+    {
+        stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+    CSVFile::CSVFile(const std::filesystem::path& path)
+        : file(path)
+    {
+        remaining = {file.data().data(), file.data().size()};
+
+        std::vector<std::string_view> fields;
+        if (nextRow(fields)) header = fields | std::ranges::to<std::vector<std::string>>();
+    }
+
+    // NOLINTNEXTLINE(readability-function-cognitive-complexity)
+    auto CSVFile::nextRow(std::vector<std::string_view>& fields) -> bool
+    {
+        constexpr std::string_view FIELD_END = ",\r\n";
+
+        fields.clear();
+        escaped.clear();
+
+        auto skip = remaining.find_first_not_of("\r\n");
+        if (skip == std::string_view::npos) return false;
+
+        const auto data = remaining.substr(skip);
+        size_t pos      = 0;
+
+        for (;;)
+        {
+            if (pos < data.size() && data[pos] == '"')
+            {
+                // quoted field, double quotes get unescaped into a copy
+                const auto start = pos + 1;
+                auto segment     = start;
+                std::string* copy = nullptr;
+
+                for (;;)
+                {
+                    auto quote = std::min(data.find('"', segment), data.size());
+                    if (quote + 1 < data.size() && data[quote + 1] == '"')
+                    {
+                        if (copy == nullptr) copy = &escaped.emplace_back();
+                        copy->append(data.substr(segment, quote + 1 - segment));
+                        segment = quote + 2;
+                        continue;
+                    }
+
+                    // anything between the closing quote and the end of the field is part of the value
+                    auto end = std::min(data.find_first_of(FIELD_END, quote), data.size());
+                    if (copy == nullptr && end > quote + 1) copy = &escaped.emplace_back();
+
+                    if (copy == nullptr)
+                        fields.push_back(data.substr(start, quote - start));
+                    else
+                    {
+                        copy->append(data.substr(segment, quote - segment));
+                        if (quote + 1 < end) copy->append(data.substr(quote + 1, end - quote - 1));
+                        fields.emplace_back(*copy);
+                    }
+
+                    pos = end;
+                    break;
+                }
+            }
+            else
+            {
+                auto end = std::min(data.find_first_of(FIELD_END, pos), data.size());
+                fields.push_back(data.substr(pos, end - pos));
+                pos = end;
+            }
+
+            if (pos >= data.size()) break;
+            if (data[pos++] == ',') continue;
+
+            if (data[pos - 1] == '\r' && pos < data.size() && data[pos] == '\n') pos++;
+            break;
+        }
+
+        remaining = data.substr(pos);
+        rowNumber++;
+        return true;
+    }
+
+    TableFileView::TableFileView(const std::filesystem::path& path)
+        : file(path)
+    {
+    }
+
+    auto TableFileView::getTableCount() const -> size_t
+    {
+        return directory.tables.size();
+    }
+
+    auto TableFileView::getName(size_t table) const -> const std::string&
+    {
+        return directory.tables.at(table).name;
+    }
+
+    auto TableFileView::getStructure(size_t table) const -> const Structure&
+    {
+        return directory.tables.at(table).structure;
+    }
+
+    auto TableFileView::getEntryCount(size_t table) const -> uint32_t
+    {
+        return directory.tables.at(table).entryCount;
+    }
+
+    auto TableFileView::findTable(std::string_view name) const -> std::optional<size_t>
+    {
+        auto itr = std::ranges::find(directory.tables, name, &EXPATable::name);
+        if (itr == directory.tables.end()) return std::nullopt;
+
+        return std::distance(directory.tables.begin(), itr);
+    }
+
+    auto TableFileView::getEntries(size_t table) -> std::expected<std::span<const std::vector<EntryValue>>, std::string>
+    {
+        auto& cached = entries.at(table);
+        if (!cached)
+        {
+            auto result = readChunks();
+            if (!result) return std::unexpected(result.error());
+
+            cached = decode(table);
+        }
+
+        return cached.value();
+    }
+
+    auto TableFileView::getColumnTable(size_t table) -> std::expected<ColumnTable, std::string>
+    {
+        auto result = readChunks();
+        if (!result) return std::unexpected(result.error());
+
+        const auto& entry = directory.tables.at(table);
+        ColumnTable columns(entry.name, entry.structure);
+        try
+        {
+            for (uint32_t i = 0; i < entry.entryCount; i++)
+                columns.addRow(entry.structure.readEXPA(file.data().data() + entry.getRowOffset(i), chunks.value()));
+        }
+        catch (const std::exception& ex)
+        {
+            return std::unexpected(ex.what());
+        }
+
+        return columns;
+    }
+
+    auto TableFileView::toTableFile() -> std::expected<TableFile, std::string>
+    {
+        auto result = readChunks();
+        if (!result) return std::unexpected(result.error());
+
+        std::vector<Table> tables;
+        for (size_t i = 0; i < directory.tables.size(); i++)
+        {
+            const auto& table = directory.tables[i];
+            tables.emplace_back(table.name, table.structure, entries[i] ? entries[i].value() : decode(i));
+        }
+
+        return TableFile{tables};
+    }
+
+    auto TableFileView::readChunks() -> std::expected<void, std::string>
+    {
+        if (chunks) return {};
+
+        auto result = CHNKLookup::read(file.data(), directory.chunkOffset);
+        if (!result) return std::unexpected(result.error());
+
+        chunks = std::move(result.value());
+        return {};
+    }
+
+    auto TableFileView::decode(size_t table) const -> std::vector<std::vector<EntryValue>>
+    {
+        const auto& entry = directory.tables.at(table);
+
+        std::vector<std::vector<EntryValue>> values;
+        values.reserve(entry.entryCount);
+
+        for (uint32_t i = 0; i < entry.entryCount; i++)
+            values.push_back(entry.structure.readEXPA(file.data().data() + entry.getRowOffset(i), chunks.value()));
+
+        return values;
+    }
+
+    auto detail::getCSVFiles(const std::filesystem::path& source) -> std::vector<std::filesystem::path>
+    {
+        std::vector<std::filesystem::path> files;
+        for (const auto& val : std::filesystem::directory_iterator(source))
+            if (val.is_regular_file()) files.push_back(val);
+        std::ranges::sort(files);
+
+        return files;
+    }
+
+    auto CHNKLookup::read(std::span<const char> data, size_t offset) -> std::expected<CHNKLookup, std::string>
+    {
+        if (offset > data.size() || data.size() - offset < sizeof(CHNKHeader))
+            return std::unexpected("Source file lacks CHNK header.");
+
+        const auto header = readAt<CHNKHeader>(data.data(), offset);
+        if (header.magic != CHNK_MAGIC) return std::unexpected("Source file lacks CHNK header.");
+        offset += sizeof(CHNKHeader);
+
+        CHNKLookup lookup;
+        lookup.data = data;
+        lookup.entries.reserve(std::min<size_t>(header.numEntry, (data.size() - offset) / (2 * sizeof(uint32_t))));
+        for (uint32_t i = 0; i < header.numEntry; i++)
+        {
+            if (data.size() - offset < 2 * sizeof(uint32_t)) return std::unexpected("Unexpected end of CHNK section.");
+
+            auto target = readAt<uint32_t>(data.data(), offset);
+            auto size   = readAt<uint32_t>(data.data(), offset + sizeof(uint32_t));
+            offset += 2 * sizeof(uint32_t);
+
+            // the pointer field the entry belongs to must be within the file
+            auto targetValid = data.size() >= sizeof(uint64_t) && target <= data.size() - sizeof(uint64_t);
+            if (data.size() - offset < size || !targetValid)
+                return std::unexpected(std::format("Invalid CHNK entry {}.", i));
+
+            lookup.entries.emplace_back(target, static_cast<uint32_t>(offset), size);
+            offset += size;
+        }
+
+        // a later entry for the same field replaces an earlier one
+        std::ranges::stable_sort(lookup.entries, {}, &Entry::target);
+        return lookup;
+    }
+
+    auto CHNKLookup::find(const char* field) const -> std::span<const char>
+    {
+        if (field < data.data() || field >= data.data() + data.size()) return {};
+
+        const auto target = static_cast<size_t>(field - data.data());
+        auto itr          = std::ranges::upper_bound(entries, target, {}, &Entry::target);
+        if (itr == entries.begin() || (--itr)->target != target) return {};
+
+        return data.subspan(itr->offset, itr->size);
+    }
+
     auto exportCSV(const TableFile& file, const std::filesystem::path& target) -> std::expected<void, std::string>
     {
         if (std::filesystem::exists(target) && !std::filesystem::is_directory(target))
@@ -358,9 +995,10 @@ namespace mvgltools::expa
 
             if (!stream) return std::unexpected("Failed to write target file.");
 
-            stream << table.structure.getCSVHeader() << "\n";
-            std::ranges::for_each(table.entries,
-                                  [&](const auto& val) { stream << table.structure.writeCSV(val) << "\n"; });
+            CSVWriter writer(stream);
+            table.structure.writeCSVHeader(writer);
+            for (const auto& entry : table.entries)
+                table.structure.writeCSV(entry, writer);
         }
 
         return {};
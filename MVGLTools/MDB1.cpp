@@ -1,14 +1,22 @@
 
 #include "MDB1.h"
 
+#include <boost/regex.hpp>
+
 #include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <deque>
+#include <expected>
 #include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
 #include <iterator>
+#include <span>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -63,7 +71,65 @@ namespace
         return {.compareBit = INVALID, .left = INVALID, .right = 0, .name{}};
     }
 
-    inline auto buildMDB1Path(const std::filesystem::path& path) -> std::string
+    auto globToRegex(std::string_view glob) -> std::string
+    {
+        constexpr std::string_view SPECIAL_CHARS = "\\^$.|+(){}[]";
+
+        // patterns without a separator apply to the file name, in any folder
+        std::string result = glob.find('/') == std::string_view::npos ? "(^|/)" : "^";
+        for (size_t i = 0; i < glob.size(); i++)
+        {
+            const auto current = glob[i];
+            const auto rest    = glob.substr(i);
+
+            if (rest.starts_with("**/"))
+            {
+                result += "(.*/)?";
+                i += 2;
+            }
+            else if (rest.starts_with("**"))
+            {
+                result += ".*";
+                i++;
+            }
+            else if (current == '*')
+                result += "[^/]*";
+            else if (current == '?')
+                result += "[^/]";
+            else if (current == '[' && rest.find(']', 2) != std::string_view::npos)
+            {
+                auto end   = rest.find(']', 2);
+                auto chars = rest.substr(1, end - 1);
+
+                result += '[';
+                if (chars.starts_with('!'))
+                {
+                    result += '^';
+                    chars.remove_prefix(1);
+                }
+                for (auto chr : chars)
+                {
+                    if (chr == '\\' || chr == '[') result += '\\';
+                    result += chr;
+                }
+                result += ']';
+                i += end;
+            }
+            else
+            {
+                if (SPECIAL_CHARS.find(current) != std::string_view::npos) result += '\\';
+                result += current;
+            }
+        }
+
+        return result + '$';
+    }
+
+} // namespace
+
+namespace mvgltools::mdb1::detail
+{
+    auto buildMDB1Path(const std::filesystem::path& path) -> std::string
     {
         auto extension = path.extension().string().substr(1, 5);
         auto tmp       = path;
@@ -75,28 +141,84 @@ namespace
         std::array<char, 0x81> name{};
         strncpy(name.data(), extension.c_str(), 4);
         strncpy(name.data() + 4, fileName.c_str(), 0x7C);
-        name[0x80] = '0'; // prevent overflow
+        name[0x80] = '\0'; // prevent overflow
 
         return name.data();
     }
 
-} // namespace
+    auto readFileData(const std::filesystem::path& file) -> std::expected<std::vector<char>, std::string>
+    {
+        std::ifstream input(file, std::ios::in | std::ios::binary);
 
-namespace mvgltools::mdb1::detail
-{
-    // NOLINTNEXTLINE(readability-function-cognitive-complexity)
-    auto generateTree(const std::vector<std::filesystem::path>& paths, const std::filesystem::path& source)
-        -> std::vector<TreeNode>
-    {
-        std::vector<TreeName> fileNames;
-        std::ranges::transform(paths,
-                               std::back_inserter(fileNames),
-                               [&](const auto& path)
-                               {
-                                   auto relPath = std::filesystem::relative(path, source);
-                                   return TreeName{buildMDB1Path(relPath), path};
-                               });
+        if (!input.good()) return std::unexpected(std::format("Error: failed to read {}", file.string()));
+
+        std::vector<char> data(std::filesystem::file_size(file));
+        input.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+        if (!input) return std::unexpected(std::format("Error: failed to read {}", file.string()));
+        return data;
+    }
+
+    auto readManifest(const std::filesystem::path& path) -> Manifest
+    {
+        std::ifstream input(path);
+        std::string line;
+        if (!std::getline(input, line) || line != MANIFEST_HEADER) return {};
+
+        Manifest manifest;
+        while (std::getline(input, line))
+        {
+            // <checksum> <full size> <write time> <name>, the name might contain spaces
+            std::istringstream stream(line);
+            ManifestEntry entry{};
+            stream >> std::hex >> entry.checksum >> std::dec >> entry.fullSize >> entry.writeTime;
+            stream.ignore(1);
+
+            std::string name;
+            if (stream && std::getline(stream, name) && !name.empty()) manifest[name] = entry;
+        }
+
+        return manifest;
+    }
+
+    auto writeManifest(const std::filesystem::path& path, const Manifest& manifest) -> std::expected<void, std::string>
+    {
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream output(path);
+        output << MANIFEST_HEADER << '\n';
+        for (const auto& [name, entry] : manifest)
+            output << std::format("{:016x} {} {} {}\n", entry.checksum, entry.fullSize, entry.writeTime, name);
+
+        if (!output) return std::unexpected(std::format("Error: failed to write {}.", path.string()));
+        return {};
+    }
 
+    auto duplicateFile(const std::filesystem::path& source, const std::filesystem::path& target, DuplicateMode mode)
+        -> std::expected<void, std::string>
+    {
+        auto prepared = prepareOutputFile(target);
+        if (!prepared) return prepared;
+
+        if (mode != DuplicateMode::COPY && cloneFile(source, target)) return {};
+
+        std::error_code error;
+        if (mode == DuplicateMode::HARDLINK)
+        {
+            std::filesystem::create_hard_link(source, target, error);
+            if (!error) return {};
+        }
+
+        std::filesystem::copy_file(source, target, error);
+        if (error)
+            return std::unexpected(std::format("Error: failed to write {}: {}", target.string(), error.message()));
+
+        return {};
+    }
+
+    // NOLINTNEXTLINE(readability-function-cognitive-complexity)
+    auto generateTree(const std::vector<TreeName>& fileNames) -> std::vector<TreeNode>
+    {
         struct QueueEntry
         {
             uint64_t parentNode;
@@ -171,4 +293,102 @@ namespace mvgltools::mdb1::detail
 
         return nodes;
     }
-} // namespace mvgltools::mdb1::detail
\ No newline at end of file
+
+    auto getCryptKeystream() -> std::span<const uint8_t>
+    {
+        static const auto keystream = []
+        {
+            std::vector<uint8_t> result(CRYPT_KEY_1.size() * CRYPT_KEY_2.size());
+            for (size_t i = 0; i < result.size(); i++)
+                result[i] = CRYPT_KEY_1[i % CRYPT_KEY_1.size()] ^ CRYPT_KEY_2[i % CRYPT_KEY_2.size()];
+            return result;
+        }();
+
+        return keystream;
+    }
+} // namespace mvgltools::mdb1::detail
+
+namespace mvgltools::mdb1
+{
+    auto FileFilter::addGlob(std::string_view pattern, bool exclude) -> std::expected<void, std::string>
+    {
+        return addRegex(globToRegex(pattern), exclude);
+    }
+
+    auto FileFilter::addRegex(const std::string& pattern, bool exclude) -> std::expected<void, std::string>
+    {
+        boost::regex regex{pattern, boost::regex::no_except};
+        if (regex.status() != 0) return std::unexpected(std::format("Error: invalid pattern '{}'.", pattern));
+
+        (exclude ? excludes : includes).push_back(std::move(regex));
+        return {};
+    }
+
+    void FileFilter::addName(std::string name, bool exclude)
+    {
+        std::ranges::replace(name, '\\', '/');
+        (exclude ? excludedNames : includedNames).insert(std::move(name));
+    }
+
+    auto FileFilter::matches(std::string path) const -> bool
+    {
+        std::ranges::replace(path, '\\', '/');
+        auto isMatch = [&path](const boost::regex& pattern) { return boost::regex_search(path, pattern); };
+
+        if (excludedNames.contains(path) || std::ranges::any_of(excludes, isMatch)) return false;
+        if (includes.empty() && includedNames.empty()) return true;
+
+        return includedNames.contains(path) || std::ranges::any_of(includes, isMatch);
+    }
+
+    auto FileFilter::isEmpty() const -> bool
+    {
+        return includes.empty() && includedNames.empty() && excludes.empty() && excludedNames.empty();
+    }
+
+    auto convertArchiveEncryption(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<ArchiveEncryption, std::string>
+    {
+        using Header = DSCS::Header;
+
+        if (std::filesystem::exists(target) && std::filesystem::equivalent(source, target))
+            return std::unexpected(std::format("Error: {} is both source and target.", source.string()));
+
+        std::ifstream input(source, std::ios::in | std::ios::binary);
+        auto header = read<Header>(input);
+        if (!input) return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", source.string()));
+
+        // the encrypted magic value is just the regular one, put through the keystream
+        const auto encrypted = header.magicValue == MDB1_CRYPTED_MAGIC_VALUE;
+        if (encrypted) cryptArray(reinterpret_cast<char*>(&header), sizeof(Header), 0);
+        if (header.magicValue != MDB1_MAGIC_VALUE)
+            return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", source.string()));
+
+        const uint64_t tableSize = sizeof(Header) + (sizeof(DSCS::TreeEntry) * header.fileEntryCount) +
+                                   (sizeof(DSCS::NameEntry) * header.fileNameCount) +
+                                   (sizeof(DSCS::DataEntry) * header.dataEntryCount);
+        const auto fileSize      = std::filesystem::file_size(source);
+        if (header.fileEntryCount != header.fileNameCount || header.dataStart < tableSize ||
+            header.dataStart > header.totalSize || header.totalSize > fileSize)
+            return std::unexpected(std::format("Error: {} has an invalid MDB1 header.", source.string()));
+
+        input.seekg(0);
+        std::ofstream output(target, std::ios::out | std::ios::binary);
+        if (!output) return std::unexpected(std::format("Error: failed to open {}.", target.string()));
+
+        std::vector<char> buffer(16 * 1024 * 1024);
+        for (uint64_t offset = 0; offset < fileSize;)
+        {
+            auto count = std::min<uint64_t>(buffer.size(), fileSize - offset);
+            input.read(buffer.data(), static_cast<std::streamsize>(count));
+            if (!input) return std::unexpected(std::format("Error: failed to read {}.", source.string()));
+
+            cryptArray(buffer.data(), count, offset);
+            output.write(buffer.data(), static_cast<std::streamsize>(count));
+            offset += count;
+        }
+
+        if (!output) return std::unexpected(std::format("Error: failed to write {}.", target.string()));
+        return encrypted ? ArchiveEncryption::PLAIN : ArchiveEncryption::ENCRYPTED;
+    }
+} // namespace mvgltools::mdb1
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "Tar.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <utility>
+
+namespace
+{
+    constexpr size_t BLOCK_SIZE = 512;
+    constexpr char TYPE_FILE    = '0';
+    constexpr char TYPE_LINK    = '1';
+    constexpr char TYPE_PAX     = 'x';
+
+    struct UstarHeader
+    {
+        std::array<char, 100> name;
+        std::array<char, 8> mode;
+        std::array<char, 8> uid;
+        std::array<char, 8> gid;
+        std::array<char, 12> size;
+        std::array<char, 12> mtime;
+        std::array<char, 8> checksum;
+        char type;
+        std::array<char, 100> linkName;
+        std::array<char, 6> magic;
+        std::array<char, 2> version;
+        std::array<char, 32> userName;
+        std::array<char, 32> groupName;
+        std::array<char, 8> deviceMajor;
+        std::array<char, 8> deviceMinor;
+        std::array<char, 155> prefix;
+        std::array<char, 12> padding;
+    };
+    static_assert(sizeof(UstarHeader) == BLOCK_SIZE);
+
+    template<size_t N>
+    constexpr auto fitsOctal(uint64_t value) -> bool
+    {
+        // N - 1 digits, followed by a NUL
+        return ((N - 1) * 3 >= 64) || value < (1ULL << ((N - 1) * 3));
+    }
+
+    template<size_t N>
+    void writeOctal(std::array<char, N>& field, uint64_t value)
+    {
+        for (size_t i = N - 1; i-- > 0; value >>= 3)
+            field[i] = static_cast<char>('0' + (value & 7));
+    }
+
+    template<size_t N>
+    void writeString(std::array<char, N>& field, const std::string& value)
+    {
+        std::ranges::copy_n(value.begin(), static_cast<ptrdiff_t>(std::min(value.size(), N)), field.begin());
+    }
+
+    /**
+     * Split a name into the prefix and name fields of a ustar header, at a '/'.
+     */
+    auto splitName(const std::string& name) -> std::optional<std::pair<std::string, std::string>>
+    {
+        constexpr auto NAME_SIZE   = sizeof(UstarHeader::name);
+        constexpr auto PREFIX_SIZE = sizeof(UstarHeader::prefix);
+        if (name.size() <= NAME_SIZE) return std::pair{std::string(), name};
+
+        auto split = name.rfind('/', PREFIX_SIZE);
+        if (split == std::string::npos || name.size() - split - 1 > NAME_SIZE) return std::nullopt;
+
+        return std::pair{name.substr(0, split), name.substr(split + 1)};
+    }
+
+    /**
+     * Format a pax extended header record, which starts with its own length in decimal.
+     */
+    auto paxRecord(const std::string& key, const std::string& value) -> std::string
+    {
+        const auto base = key.size() + value.size() + 3; // space, '=' and newline
+        auto length     = base;
+        while (length != base + std::to_string(length).size())
+            length = base + std::to_string(length).size();
+
+        return std::to_string(length) + " " + key + "=" + value + "\n";
+    }
+} // namespace
+
+namespace mvgltools::tar
+{
+    TarWriter::TarWriter(std::ostream& output, int64_t mtime)
+        : output(output)
+        , mtime(mtime)
+    {
+    }
+
+    void TarWriter::addFile(const std::string& name, std::span<const char> data)
+    {
+        writeHeader(name, data.size(), TYPE_FILE, "");
+        writeData(data);
+    }
+
+    void TarWriter::addHardLink(const std::string& name, const std::string& target)
+    {
+        writeHeader(name, 0, TYPE_LINK, target);
+    }
+
+    void TarWriter::finish()
+    {
+        constexpr std::array<char, BLOCK_SIZE * 2> END{};
+        output.write(END.data(), END.size());
+        output.flush();
+    }
+
+    void TarWriter::writeHeader(const std::string& name, uint64_t size, char type, const std::string& linkName)
+    {
+        auto split = splitName(name);
+
+        // everything that doesn't fit into the ustar header goes into a pax header for the entry
+        std::string records;
+        if (!split) records += paxRecord("path", name);
+        if (!fitsOctal<sizeof(UstarHeader::size)>(size)) records += paxRecord("size", std::to_string(size));
+        if (linkName.size() > sizeof(UstarHeader::linkName)) records += paxRecord("linkpath", linkName);
+        if (!records.empty())
+        {
+            auto fileName = name.substr(name.rfind('/') + 1).substr(0, sizeof(UstarHeader::name) - 10);
+            writeHeader("PaxHeader/" + fileName, records.size(), TYPE_PAX, "");
+            writeData(records);
+        }
+
+        UstarHeader header{};
+        if (split)
+        {
+            writeString(header.prefix, split->first);
+            writeString(header.name, split->second);
+        }
+        else
+            writeString(header.name, name.substr(name.rfind('/') + 1));
+
+        writeOctal(header.mode, 0644); // NOLINT(readability-magic-numbers)
+        writeOctal(header.uid, 0);
+        writeOctal(header.gid, 0);
+        writeOctal(header.size, fitsOctal<sizeof(UstarHeader::size)>(size) ? size : 0);
+        writeOctal(header.mtime, std::max<int64_t>(mtime, 0));
+        header.type = type;
+        writeString(header.linkName, linkName);
+        writeString(header.magic, std::string("ustar"));
+        writeString(header.version, std::string("00"));
+
+        // the checksum is calculated with the checksum field filled with spaces
+        header.checksum.fill(' ');
+        auto bytes    = std::span(reinterpret_cast<const unsigned char*>(&header), sizeof(header));
+        auto checksum = std::accumulate(bytes.begin(), bytes.end(), 0U);
+        writeOctal(header.checksum, checksum);
+        header.checksum[7] = ' ';
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void TarWriter::writeData(std::span<const char> data)
+    {
+        constexpr std::array<char, BLOCK_SIZE> PADDING{};
+        const auto padding = (BLOCK_SIZE - (data.size() % BLOCK_SIZE)) % BLOCK_SIZE;
+        output.write(data.data(), static_cast<std::streamsize>(data.size()));
+        output.write(PADDING.data(), static_cast<std::streamsize>(padding));
+    }
+} // namespace mvgltools::tar
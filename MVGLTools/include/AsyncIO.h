@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mvgltools
+{
+    /**
+     * Asynchronous file I/O for extracting many files out of a single archive, using io_uring. Reads from the archive
+     * as well as creating, writing and closing the extracted files are queued and submitted to the kernel in batches,
+     * by a thread owned by the instance, so many small files don't cost a blocking syscall each.
+     *
+     * Only available on Linux, when built with the MVGLTOOLS_IO_URING CMake option. Callers are expected to fall back
+     * to regular file streams when create returns nullptr.
+     */
+    class AsyncIO
+    {
+    public:
+        using ReadResult    = std::expected<std::vector<char>, std::string>;
+        using ReadCallback  = std::function<void(ReadResult)>;
+        using WriteCallback = std::function<void(std::expected<void, std::string>)>;
+
+        static constexpr uint32_t DEFAULT_DEPTH = 256;
+
+        /**
+         * Start the I/O thread.
+         *
+         * @param source the file to read from
+         * @param depth the maximum number of operations in flight at once
+         * @return the instance, or nullptr if io_uring is disabled or not supported by the kernel
+         */
+        static auto create(const std::filesystem::path& source, uint32_t depth = DEFAULT_DEPTH)
+            -> std::unique_ptr<AsyncIO>;
+
+        /**
+         * Waits until all queued operations are done and their callbacks returned.
+         */
+        ~AsyncIO();
+
+        AsyncIO(const AsyncIO&)                    = delete;
+        auto operator=(const AsyncIO&) -> AsyncIO& = delete;
+
+        /**
+         * Queue a read from the source file. Safe to be called from any thread, including callbacks.
+         *
+         * @param done called with the read data on the I/O thread, must not throw and should hand off heavy work.
+         *             Empty reads and reads after the ring failed are completed right away, on the calling thread.
+         */
+        void read(uint64_t offset, uint64_t size, ReadCallback done);
+
+        /**
+         * Queue the creation of a file with the given content. The parent directory must exist. An existing file gets
+         * truncated and written in place, so one that might have other hardlinks needs to be removed before. Safe to be
+         * called from any thread, including callbacks.
+         *
+         * @param done called on the I/O thread once the file is closed, must not throw and should hand off heavy work.
+         *             After the ring failed it's called right away, on the calling thread.
+         */
+        void writeFile(std::filesystem::path path, std::vector<char> data, WriteCallback done);
+
+    private:
+        struct Ring;
+        struct Operation;
+
+        std::unique_ptr<Ring> ring;
+        std::mutex queueMutex;
+        std::deque<std::unique_ptr<Operation>> queue;
+        bool stopping{false};
+        /**
+         * The error that made the ring unusable, once it happened.
+         */
+        std::string failure;
+        std::thread thread;
+
+        explicit AsyncIO(std::unique_ptr<Ring> ring);
+
+        void enqueue(std::unique_ptr<Operation> operation);
+        void run();
+        /**
+         * Fail all pending and future operations, after the ring stopped working.
+         */
+        void fail(std::deque<std::unique_ptr<Operation>>& backlog, int error);
+    };
+} // namespace mvgltools
@@ -0,0 +1,117 @@
+#pragma once
+#include "EXPA.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace mvgltools::expa
+{
+    /**
+     * Represents a string stored in the string arena of a ColumnTable. The offsets are 32 bit, which limits the arena
+     * to 4 GiB.
+     */
+    struct StringRef
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /**
+     * Represents a column of int32 arrays. The values of row i are stored in values[offsets[i], offsets[i + 1]).
+     */
+    struct ArrayColumn
+    {
+        std::vector<uint32_t> offsets{0};
+        std::vector<int32_t> values;
+    };
+
+    /**
+     * Represents the data of a single column, depending on its entry type. Bools are stored as one byte per row, empty
+     * columns don't store anything.
+     */
+    using Column = std::variant<std::monostate,
+                                std::vector<uint8_t>,
+                                std::vector<int8_t>,
+                                std::vector<int16_t>,
+                                std::vector<int32_t>,
+                                std::vector<float>,
+                                std::vector<StringRef>,
+                                ArrayColumn>;
+
+    /**
+     * Represents a structured data table in columnar layout, as alternative to the row based Table. Every column is
+     * stored as one typed array, strings of all columns share a single arena.
+     */
+    class ColumnTable
+    {
+    public:
+        ColumnTable(std::string name, Structure structure);
+
+        /**
+         * Convert a row based table into a columnar one.
+         */
+        static auto fromTable(const Table& table) -> ColumnTable;
+
+        /**
+         * Convert this table into a row based one.
+         */
+        [[nodiscard]] auto toTable() const -> Table;
+
+        [[nodiscard]] auto getName() const -> const std::string&;
+        [[nodiscard]] auto getStructure() const -> const Structure&;
+        [[nodiscard]] auto getRowCount() const -> size_t;
+        [[nodiscard]] auto getColumnCount() const -> size_t;
+
+        /**
+         * Append a row of entry values, matching the structure of this table.
+         */
+        void addRow(const std::vector<EntryValue>& row);
+
+        /**
+         * Get a row as entry values, as used by the row based Table.
+         */
+        [[nodiscard]] auto getRow(size_t row) const -> std::vector<EntryValue>;
+
+        /**
+         * Get a single value as entry value.
+         */
+        [[nodiscard]] auto getValue(size_t row, size_t column) const -> EntryValue;
+
+        /**
+         * Get the raw data of a scalar column. The type must match the storage type of the column, i.e. uint8_t for
+         * bools, otherwise std::bad_variant_access is thrown.
+         */
+        template<typename T>
+        [[nodiscard]] auto getColumn(size_t column) const -> std::span<const T>
+        {
+            return std::get<std::vector<T>>(columns.at(column));
+        }
+
+        /**
+         * Get a string value, viewing into the string arena.
+         */
+        [[nodiscard]] auto getString(size_t row, size_t column) const -> std::string_view;
+
+        /**
+         * Get an int32 array value, viewing into the column data.
+         */
+        [[nodiscard]] auto getArray(size_t row, size_t column) const -> std::span<const int32_t>;
+
+        /**
+         * Get the number of bytes allocated for the data of this table.
+         */
+        [[nodiscard]] auto getMemoryUsage() const -> size_t;
+
+    private:
+        std::string name;
+        Structure structure;
+        std::vector<Column> columns;
+        std::string strings;
+        size_t rowCount{0};
+    };
+} // namespace mvgltools::expa
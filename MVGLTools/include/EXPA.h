@@ -6,12 +6,14 @@
 #include <boost/regex.hpp>
 #include <boost/regex/v5/regex_fwd.hpp>
 #include <boost/regex/v5/regex_search.hpp>
-#include <parser.hpp>
 
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <expected>
 #include <filesystem>
 #include <format>
@@ -19,9 +21,13 @@
 #include <ios>
 #include <map>
 #include <optional>
+#include <ostream>
 #include <ranges>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -51,6 +57,53 @@ namespace mvgltools::expa
         EMPTY       = 10,
     };
 
+    /**
+     * Represents a CHNKEntry for an EXPA file, referencing the data of the entry value it originates from.
+     * The referenced data is padded with zeroes to the given size when written.
+     */
+    struct CHNKReference
+    {
+        uint32_t offset;
+        std::span<const char> value;
+        uint32_t size;
+    };
+
+    /**
+     * Represents the CHNK section of an EXPA file, which holds the data of the strings and arrays of the rows. Rows
+     * refer to it by the offset of their pointer fields, which get looked up here instead of being resolved within the
+     * file, so the file itself is never modified.
+     */
+    class CHNKLookup
+    {
+    public:
+        CHNKLookup() = default;
+
+        /**
+         * Read the CHNK section of an EXPA file.
+         *
+         * @param data the EXPA file, must stay alive as long as the lookup is used
+         * @param offset the offset of the CHNK header
+         * @return the lookup if successful, an error string otherwise
+         */
+        static auto read(std::span<const char> data, size_t offset) -> std::expected<CHNKLookup, std::string>;
+
+        /**
+         * Get the data referred to by the pointer field at the given address within the file, empty if there is none.
+         */
+        [[nodiscard]] auto find(const char* field) const -> std::span<const char>;
+
+    private:
+        struct Entry
+        {
+            uint32_t target;
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        std::span<const char> data;
+        std::vector<Entry> entries;
+    };
+
     /**
      * Represents a CHNKEntry for an EXPA file.
      */
@@ -61,6 +114,7 @@ namespace mvgltools::expa
 
         CHNKEntry(uint32_t offset, const std::string& data);
         CHNKEntry(uint32_t offset, const std::vector<int32_t>& data);
+        explicit CHNKEntry(const CHNKReference& reference);
     };
 
     /**
@@ -82,6 +136,83 @@ namespace mvgltools::expa
         EntryType type;
     };
 
+    /**
+     * Buffered writer for CSV data. Fields are formatted into a reusable buffer, which is written to the stream
+     * whenever a row ends and the buffer exceeds the flush size, on flush and on destruction.
+     */
+    class CSVWriter
+    {
+    public:
+        static constexpr size_t DEFAULT_FLUSH_SIZE = 1024 * 1024;
+
+        explicit CSVWriter(std::ostream& stream, size_t flushSize = DEFAULT_FLUSH_SIZE);
+        ~CSVWriter();
+
+        CSVWriter(const CSVWriter&)                    = delete;
+        CSVWriter(CSVWriter&&)                         = delete;
+        auto operator=(const CSVWriter&) -> CSVWriter& = delete;
+        auto operator=(CSVWriter&&) -> CSVWriter&      = delete;
+
+        /**
+         * Write a field as is, without quoting.
+         */
+        void writeField(std::string_view value);
+
+        /**
+         * Write a field as quoted string, escaping contained quotes.
+         */
+        void writeString(std::string_view value);
+
+        /**
+         * Write a field as integer.
+         */
+        template<std::integral T>
+        void writeInteger(T value)
+        {
+            std::array<char, 24> data{};
+            auto result = std::to_chars(data.data(), data.data() + data.size(), value);
+            writeField({data.data(), result.ptr});
+        }
+
+        /**
+         * Write a field as float, using the shortest representation that round-trips.
+         */
+        void writeFloat(float value);
+
+        /**
+         * Write a field as bool, i.e. true or false.
+         */
+        void writeBool(bool value);
+
+        /**
+         * Write a field as space separated list of integers.
+         */
+        void writeIntArray(std::span<const int32_t> values);
+
+        /**
+         * Write an entry value as field, formatted according to the given type.
+         */
+        void writeValue(EntryType type, const EntryValue& value);
+
+        /**
+         * End the current row.
+         */
+        void endRow();
+
+        /**
+         * Write the buffered data to the stream.
+         */
+        void flush();
+
+    private:
+        std::ostream& stream;
+        std::string buffer;
+        size_t flushSize;
+        bool firstField{true};
+
+        void separate();
+    };
+
     /**
      * Represents the structure of a data table.
      */
@@ -108,10 +239,33 @@ namespace mvgltools::expa
          */
         [[nodiscard]] auto writeEXPA(const std::vector<EntryValue>& entries) const -> EXPAEntry;
 
+        /**
+         * Write a vector of entry values, representing a row of this structure, into a raw buffer. The caller must make
+         * sure the buffer is at least getEXPASize() large and pre-filled.
+         *
+         * @param entries the row to write
+         * @param data the buffer to write into
+         * @param baseOffset the offset of the buffer within the file, used for the CHNK entries
+         * @param chunk the vector to append the CHNK entries of the row to, they reference the passed entries
+         */
+        void writeEXPA(const std::vector<EntryValue>& entries,
+                       char* data,
+                       uint32_t baseOffset,
+                       std::vector<CHNKReference>& chunk) const;
+
+        /**
+         * Gets the number of CHNK entries a row of this structure creates and their total size, including their
+         * offset and size fields.
+         */
+        [[nodiscard]] auto getCHNKSize(const std::vector<EntryValue>& entries) const -> std::pair<uint32_t, size_t>;
+
         /**
          * Read a row of entry values from a raw buffer. The caller must make sure there is enough data to read.
+         *
+         * @param data the row within the EXPA file
+         * @param chunks the CHNK section of the same file
          */
-        [[nodiscard]] auto readEXPA(const char* data) const -> std::vector<EntryValue>;
+        [[nodiscard]] auto readEXPA(const char* data, const CHNKLookup& chunks) const -> std::vector<EntryValue>;
 
         /**
          * Gets the size of an entry of this structure when written in the EXPA format.
@@ -128,10 +282,39 @@ namespace mvgltools::expa
          */
         [[nodiscard]] auto writeCSV(const std::vector<EntryValue>& entries) const -> std::string;
 
+        /**
+         * Write the CSV header row of this structure into the given writer.
+         */
+        void writeCSVHeader(CSVWriter& writer) const;
+
+        /**
+         * Write a vector of entry values, representing a row of this structure, into the given writer.
+         */
+        void writeCSV(const std::vector<EntryValue>& entries, CSVWriter& writer) const;
+
+        /**
+         * Write a row of this structure from a raw buffer into the given writer, without converting it into entry
+         * values first.
+         *
+         * @param data the row within the EXPA file
+         * @param chunks the CHNK section of the same file
+         */
+        void writeCSV(const char* data, const CHNKLookup& chunks, CSVWriter& writer) const;
+
         /**
          * Convert a vector of strings into a vector of entry values, representing a row of this structure.
+         * Throws std::invalid_argument if a field can't be parsed.
          */
         [[nodiscard]] auto readCSV(const std::vector<std::string>& data) const -> std::vector<EntryValue>;
+
+        /**
+         * Convert a row of CSV fields into a vector of entry values, representing a row of this structure.
+         *
+         * @param data the fields of the row, there must be at least one per structure entry
+         * @return the entry values if successful, an error string naming the failing column otherwise
+         */
+        [[nodiscard]] auto readCSV(std::span<const std::string_view> data) const
+            -> std::expected<std::vector<EntryValue>, std::string>;
     };
 
     /**
@@ -205,6 +388,15 @@ namespace mvgltools::expa
     template<EXPA expa>
     auto writeEXPA(const TableFile& file, const std::filesystem::path& path) -> std::expected<void, std::string>;
 
+    /**
+     * Serialise a table file as EXPA into a single buffer.
+     *
+     * @param file the table file to serialise
+     * @return the serialised EXPA file
+     */
+    template<EXPA expa>
+    auto buildEXPA(const TableFile& file) -> std::vector<char>;
+
     /**
      * Reads an EXPA file into a table file.
      *
@@ -214,6 +406,16 @@ namespace mvgltools::expa
     template<EXPA expa>
     auto readEXPA(const std::filesystem::path& path) -> std::expected<TableFile, std::string>;
 
+    /**
+     * Reads the table names and structures of an EXPA file, without reading any rows.
+     *
+     * @param path the path to read from
+     * @return the name and structure of every table if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto readEXPAStructures(const std::filesystem::path& path)
+        -> std::expected<std::vector<std::pair<std::string, Structure>>, std::string>;
+
     /**
      * Write a table file as CSV into the given path
      *
@@ -231,6 +433,53 @@ namespace mvgltools::expa
      */
     template<EXPA expa>
     auto importCSV(const std::filesystem::path& source) -> std::expected<TableFile, std::string>;
+
+    /**
+     * Convert an EXPA file into a CSV folder, writing every row directly from the mapped file without reading the
+     * whole file into a table file first.
+     *
+     * @param source the EXPA file to read from
+     * @param target the folder to write the CSV files to
+     * @return void if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto convertEXPAToCSV(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<void, std::string>;
+
+    /**
+     * Convert an EXPA file held in memory into a CSV folder.
+     *
+     * @param data the EXPA file to read from
+     * @param path the path of the EXPA file, used to look up the structures
+     * @param target the folder to write the CSV files to
+     * @return void if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto convertEXPAToCSV(std::span<const char> data,
+                          const std::filesystem::path& path,
+                          const std::filesystem::path& target) -> std::expected<void, std::string>;
+
+    /**
+     * Convert a CSV folder into an EXPA file, parsing one row at a time. The CSV files are read twice, once to compute
+     * the layout of the EXPA file and once to write the rows into a mapped file next to the target. It only replaces
+     * the target once it's complete.
+     *
+     * @param source the CSV folder to read from
+     * @param target the EXPA file to write to
+     * @return void if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto convertCSVToEXPA(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<void, std::string>;
+
+    /**
+     * Convert a CSV folder into an EXPA file held in memory, parsing one row at a time.
+     *
+     * @param source the CSV folder to read from
+     * @return the EXPA file if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto convertCSVToEXPA(const std::filesystem::path& source) -> std::expected<std::vector<char>, std::string>;
 } // namespace mvgltools::expa
 
 namespace mvgltools::expa::detail
@@ -250,34 +499,129 @@ namespace mvgltools::expa::detail
         uint32_t numEntry{0};
     };
 
-    struct CSVFile
+    /**
+     * Represents the position of a table within an EXPA file that is about to be written.
+     */
+    struct TableLayout
+    {
+        size_t headerOffset{};
+        size_t dataOffset{};
+        uint32_t nameSize{};
+        uint32_t entrySize{};
+        uint32_t entryCount{};
+
+        [[nodiscard]] auto getEnd() const -> size_t
+        {
+            return dataOffset + (static_cast<size_t>(entryCount) * entrySize);
+        }
+    };
+
+    /**
+     * Represents a table within an EXPA file that has been read.
+     */
+    struct EXPATable
+    {
+        std::string name;
+        size_t dataOffset{};
+        uint32_t entryCount{};
+        uint32_t entrySize{};
+        Structure structure;
+
+        [[nodiscard]] auto getRowOffset(uint32_t row) const -> size_t
+        {
+            return dataOffset + (static_cast<size_t>(row) * ceilInteger(entrySize, 8));
+        }
+    };
+
+    /**
+     * Represents the table directory of an EXPA file, i.e. everything but the rows and the CHNK data.
+     */
+    struct EXPADirectory
+    {
+        std::vector<EXPATable> tables;
+        size_t chunkOffset{};
+    };
+
+    /**
+     * Represents a CSV file, mapped into memory. Rows get tokenised on demand into views of the mapped data, only
+     * fields containing escaped quotes get copied.
+     */
+    class CSVFile
     {
     private:
+        MappedFile file;
+        std::string_view remaining;
         std::vector<std::string> header;
-        std::vector<std::vector<std::string>> rows;
+        std::deque<std::string> escaped;
+        size_t rowNumber{0};
 
     public:
-        explicit CSVFile(const std::filesystem::path& path)
+        explicit CSVFile(const std::filesystem::path& path);
+
+        /**
+         * Returns whether the file could be read.
+         */
+        [[nodiscard]] auto isOpen() const -> bool { return file.isOpen(); }
+
+        /**
+         * Get the header row of the file.
+         */
+        [[nodiscard]] auto getHeader() const -> const std::vector<std::string>& { return header; }
+
+        /**
+         * Get the number of the last read row, starting with 1 for the header.
+         */
+        [[nodiscard]] auto getRowNumber() const -> size_t { return rowNumber; }
+
+        /**
+         * Read the next row into the given vector. The views stay valid until the next call.
+         *
+         * @return true if a row was read, false if the end of the file was reached
+         */
+        auto nextRow(std::vector<std::string_view>& fields) -> bool;
+    };
+
+    /**
+     * Get the CSV files of a CSV folder, in table order.
+     */
+    auto getCSVFiles(const std::filesystem::path& source) -> std::vector<std::filesystem::path>;
+
+    /**
+     * Write the given CHNK entries into a buffer, returning the offset after the last written entry.
+     */
+    inline auto writeCHNK(char* data, size_t offset, std::span<const CHNKReference> chunk) -> size_t
+    {
+        for (const auto& val : chunk)
         {
-            std::ifstream stream(path, std::ios::in);
-            aria::csv::CsvParser parser(stream);
+            offset = writeAt(data, offset, val.offset);
+            offset = writeAt(data, offset, val.size);
+            std::ranges::copy(val.value, data + offset);
+            offset += val.size;
+        }
+        return offset;
+    }
 
-            for (const auto& row : parser)
+    /**
+     * Parse all remaining rows of a CSV file with the given structure, passing each row to func.
+     */
+    template<typename Func>
+    auto forEachCSVRow(CSVFile& csv, const std::filesystem::path& file, const Structure& structure, Func&& func)
+        -> std::expected<void, std::string>
+    {
+        std::vector<std::string_view> fields;
+        while (csv.nextRow(fields))
+        {
+            auto row = structure.readCSV(fields);
+            if (!row)
             {
-                std::vector<std::string> data;
-                for (const auto& field : row)
-                    data.push_back(field);
-
-                if (header.empty())
-                    header = data;
-                else
-                    rows.push_back(data);
+                return std::unexpected(
+                    std::format("{}, row {}: {}", file.filename().string(), csv.getRowNumber(), row.error()));
             }
+            func(row.value());
         }
 
-        [[nodiscard]] auto getHeader() const -> std::vector<std::string> { return header; }
-        [[nodiscard]] auto getRows() const -> std::vector<std::vector<std::string>> { return rows; }
-    };
+        return {};
+    }
 
     inline auto getTypeMap() -> std::map<std::string, EntryType>
     {
@@ -335,67 +679,85 @@ namespace mvgltools::expa::detail
         }
     }
 
-    template<EXPA expa>
-    auto getStructureFromFile(const std::filesystem::path& filePath, const std::string& tableName)
-        -> std::vector<StructureEntry>
+    /**
+     * Represents the structure definitions of a structure folder. The structure.json and all definitions referenced by
+     * it are read and all patterns are compiled once. Lookups are cached by file path and table name.
+     *
+     * Instances are shared process-wide and are safe to use from multiple threads.
+     */
+    class StructureRegistry
     {
-        std::string STRUCTURE_FILE = std::string(expa::STRUCTURE_FOLDER) + "structure.json";
+    public:
+        /**
+         * Get the registry for the given structure folder, loading it on first use.
+         */
+        static auto get(std::string_view folder) -> const StructureRegistry&;
 
-        if (!std::filesystem::is_directory(expa::STRUCTURE_FOLDER)) return {};
-        if (!std::filesystem::exists(STRUCTURE_FILE)) return {};
+        /**
+         * Read all structure definitions from the given folder. If the folder or its structure.json doesn't exist the
+         * registry will be empty.
+         */
+        explicit StructureRegistry(const std::filesystem::path& folder);
 
-        boost::property_tree::ptree structure;
-        boost::property_tree::read_json(STRUCTURE_FILE, structure);
+        /**
+         * Find the structure of a given table within a given file.
+         *
+         * @param filePath the path of the file, matched against the patterns of the structure.json
+         * @param tableName the name of the table, matched against the table definitions of the matched file
+         * @return the structure entries, empty if there is no definition for the table
+         */
+        [[nodiscard]] auto find(const std::filesystem::path& filePath, const std::string& tableName) const
+            -> std::vector<StructureEntry>;
 
-        std::string formatFile;
-        for (auto var : structure)
+    private:
+        struct TableDefinition
         {
-            if (boost::regex_search(filePath.string(), boost::regex{var.first}))
-            {
-                formatFile = var.second.data();
-                break;
-            }
-        }
+            std::string name;
+            std::optional<boost::regex> pattern;
+            std::vector<StructureEntry> structure;
+        };
 
-        if (formatFile.empty()) return {};
+        using Definition = std::expected<std::vector<TableDefinition>, std::string>;
+        using CacheKey   = std::pair<std::string, std::string>;
 
-        boost::property_tree::ptree format;
-        boost::property_tree::read_json(expa::STRUCTURE_FOLDER + formatFile, format);
+        std::vector<std::pair<boost::regex, const Definition*>> files;
+        std::map<std::string, Definition> definitions;
 
-        auto formatValue = format.get_child_optional(tableName);
-        if (!formatValue)
-        {
-            // Scan all table definitions to find a matching regex expression, if any
-            for (auto& kv : format)
-            {
-                if (boost::regex_search(tableName, boost::regex{wrapRegex(kv.first)}))
-                {
-                    formatValue = kv.second;
-                    break;
-                }
-            }
-        }
-        if (!formatValue) return {};
+        mutable std::shared_mutex cacheMutex;
+        mutable std::map<CacheKey, std::vector<StructureEntry>> cache;
 
-        std::vector<StructureEntry> entries;
-        for (const auto& val : formatValue.get())
-            entries.emplace_back(val.first, convertEntryType(val.second.data()));
+        [[nodiscard]] auto lookup(const std::filesystem::path& filePath, const std::string& tableName) const
+            -> std::vector<StructureEntry>;
+    };
 
-        return entries;
+    template<EXPA expa>
+    auto getStructureFromFile(const std::filesystem::path& filePath, const std::string& tableName)
+        -> std::vector<StructureEntry>
+    {
+        return StructureRegistry::get(expa::STRUCTURE_FOLDER).find(filePath, tableName);
     }
 
     template<EXPA expa>
-    auto getStructure(std::ifstream& stream, const std::filesystem::path& filePath, const std::string& tableName)
-        -> Structure
+    auto getStructure(std::span<const char> data,
+                      size_t& offset,
+                      const std::filesystem::path& filePath,
+                      const std::string& tableName) -> std::expected<Structure, std::string>
     {
         auto fromFile = getStructureFromFile<expa>(filePath, tableName);
         if constexpr (!expa::HAS_STRUCTURE_SECTION) return Structure{fromFile};
 
+        if (data.size() - offset < sizeof(uint32_t)) return std::unexpected("Unexpected end of structure section.");
+        auto structureCount = readAt<uint32_t>(data.data(), offset);
+        offset += sizeof(uint32_t);
+
+        if ((data.size() - offset) / sizeof(EntryType) < structureCount)
+            return std::unexpected("Unexpected end of structure section.");
+
         std::vector<StructureEntry> structure;
-        auto structureCount = read<uint32_t>(stream);
-        for (int32_t j = 0; j < structureCount; j++)
+        for (uint32_t j = 0; j < structureCount; j++)
         {
-            auto type = read<EntryType>(stream);
+            auto type = readAt<EntryType>(data.data(), offset);
+            offset += sizeof(EntryType);
             structure.emplace_back(std::format("{} {}", toString(type), j), type);
         }
 
@@ -423,8 +785,284 @@ namespace mvgltools::expa::detail
         return Structure{fromFile};
     }
 
+    /**
+     * Read the table directory of an EXPA file, without reading any rows.
+     *
+     * @param data the EXPA file
+     * @param path the path of the EXPA file, used to look up the structures
+     * @return the table directory if successful, an error string otherwise
+     */
+    template<EXPA expa>
+    auto readEXPADirectory(std::span<const char> data, const std::filesystem::path& path)
+        -> std::expected<EXPADirectory, std::string>
+    {
+        auto fits = [&](size_t offset, size_t size) { return offset <= data.size() && size <= data.size() - offset; };
+
+        if (!fits(0, sizeof(EXPAHeader))) return std::unexpected("Source file lacks EXPA header.");
+        const auto header = readAt<EXPAHeader>(data.data(), 0);
+        if (header.magic != EXPA_MAGIC) return std::unexpected("Source file lacks EXPA header.");
+
+        EXPADirectory directory;
+        size_t offset = sizeof(EXPAHeader);
+
+        for (int32_t i = 0; i < header.tableCount; i++)
+        {
+            offset = ceilInteger(offset, expa::ALIGN_STEP);
+            if (!fits(offset, sizeof(uint32_t))) return std::unexpected("Unexpected end of table header.");
+
+            auto nameLength = readAt<uint32_t>(data.data(), offset);
+            offset += sizeof(uint32_t);
+            if (!fits(offset, nameLength)) return std::unexpected("Unexpected end of table header.");
+
+            std::string_view nameData(data.data() + offset, nameLength);
+            std::string name(nameData.substr(0, nameData.find('\0')));
+            offset += nameLength;
+
+            auto structure = getStructure<expa>(data, offset, path, name);
+            if (!structure) return std::unexpected(structure.error());
+
+            if (!fits(offset, 2 * sizeof(uint32_t))) return std::unexpected("Unexpected end of table header.");
+            auto entrySize  = readAt<uint32_t>(data.data(), offset);
+            auto entryCount = readAt<uint32_t>(data.data(), offset + sizeof(uint32_t));
+            offset          = ceilInteger(offset + (2 * sizeof(uint32_t)), 8);
+
+            auto structureSize = structure->getEXPASize();
+            if (structureSize != ceilInteger(entrySize, 8))
+            {
+                return std::unexpected(
+                    std::format("Structure size {} doesn't match entry size {}.", structureSize, entrySize));
+            }
+
+            auto& table = directory.tables.emplace_back(name, offset, entryCount, entrySize, structure.value());
+            if (!fits(offset, table.getRowOffset(entryCount) - offset))
+                return std::unexpected(std::format("Unexpected end of table {}.", name));
+
+            offset = table.getRowOffset(entryCount);
+        }
+
+        directory.chunkOffset = ceilInteger(offset, expa::ALIGN_STEP);
+        return directory;
+    }
+
+    /**
+     * Compute the layout of a table when written as EXPA.
+     *
+     * @param offset the offset to place the table header at
+     */
+    template<EXPA expa>
+    auto getTableLayout(const std::string& name, const Structure& structure, uint32_t entryCount, size_t offset)
+        -> TableLayout
+    {
+        TableLayout layout{
+            .headerOffset = offset,
+            .nameSize     = static_cast<uint32_t>(ceilInteger(static_cast<int64_t>(name.size() + 1), 4)),
+            .entrySize    = structure.getEXPASize(),
+            .entryCount   = entryCount,
+        };
+
+        offset += sizeof(int32_t) + layout.nameSize;
+        if constexpr (expa::HAS_STRUCTURE_SECTION)
+            offset += sizeof(uint32_t) + (structure.getEntryCount() * sizeof(EntryType));
+        offset += 2 * sizeof(uint32_t);
+
+        layout.dataOffset = ceilInteger(static_cast<int64_t>(offset), 8);
+        return layout;
+    }
+
+    /**
+     * Write the header of a table into a zero initialised buffer and pre-fill its rows.
+     */
+    template<EXPA expa>
+    void writeTableHeader(char* data, const TableLayout& layout, const std::string& name, const Structure& structure)
+    {
+        auto offset = writeAt(data, layout.headerOffset, static_cast<int32_t>(layout.nameSize));
+        std::ranges::copy(name, data + offset);
+        offset += layout.nameSize;
+
+        if constexpr (expa::HAS_STRUCTURE_SECTION)
+        {
+            offset = writeAt(data, offset, static_cast<uint32_t>(structure.getEntryCount()));
+            for (const auto& val : structure.getStructure())
+                offset = writeAt(data, offset, val.type);
+        }
+
+        offset = writeAt(data, offset, layout.entrySize);
+        writeAt(data, offset, layout.entryCount);
+
+        std::fill_n(data + layout.dataOffset, layout.getEnd() - layout.dataOffset, '\xCC');
+    }
+
+    /**
+     * Convert a CSV folder into an EXPA file, parsing one row at a time. The CSV files are read twice, once to compute
+     * the layout of the EXPA file and once to write the rows.
+     *
+     * @param source the CSV folder to read from
+     * @param allocate called with the final size once it is known, must return a zero initialised buffer of that size
+     * @return void if successful, an error string otherwise
+     */
+    template<EXPA expa, typename Alloc>
+    auto writeCSVAsEXPA(const std::filesystem::path& source, Alloc&& allocate) -> std::expected<void, std::string>
+    {
+        struct TableInfo
+        {
+            std::filesystem::path file;
+            std::string name;
+            Structure structure;
+            TableLayout layout;
+        };
+
+        if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source))
+            return std::unexpected("Source path doesn't exist or is not a directory.");
+
+        // first pass, validate the rows and compute the layout
+        std::vector<TableInfo> tables;
+        size_t size         = sizeof(EXPAHeader);
+        size_t chunkSize    = sizeof(CHNKHeader);
+        uint32_t chunkCount = 0;
+
+        for (const auto& file : getCSVFiles(source))
+        {
+            CSVFile csv(file);
+            if (!csv.isOpen()) return std::unexpected(std::format("Failed to read {}.", file.string()));
+
+            auto name      = file.stem().generic_string().substr(4);
+            auto structure = getStructureCSV<expa>(csv, source, name);
+
+            uint32_t entryCount = 0;
+            auto result         = forEachCSVRow(csv,
+                                        file,
+                                        structure,
+                                        [&](const auto& row)
+                                        {
+                                            auto [count, bytes] = structure.getCHNKSize(row);
+                                            chunkCount += count;
+                                            chunkSize += bytes;
+                                            entryCount++;
+                                        });
+            if (!result) return std::unexpected(result.error());
+
+            auto layout = getTableLayout<expa>(name, structure, entryCount, size);
+            size        = layout.getEnd();
+            tables.emplace_back(file, name, structure, layout);
+        }
+
+        // second pass, write the rows into the target
+        auto output = allocate(size + chunkSize);
+        if (output.size() != size + chunkSize) return std::unexpected("Failed to write target file.");
+
+        auto* data       = output.data();
+        const auto limit = output.size();
+
+        writeAt(data, 0, EXPAHeader{.tableCount = static_cast<int32_t>(tables.size())});
+        auto chunkOffset = writeAt(data, size, CHNKHeader{.numEntry = chunkCount});
+
+        std::vector<CHNKReference> chunk;
+        for (const auto& table : tables)
+        {
+            CSVFile csv(table.file);
+            if (!csv.isOpen()) return std::unexpected(std::format("Failed to read {}.", table.file.string()));
+
+            writeTableHeader<expa>(data, table.layout, table.name, table.structure);
+
+            auto rowOffset    = table.layout.dataOffset;
+            uint32_t rowCount = 0;
+            bool changed      = false;
+            auto result       = forEachCSVRow(csv,
+                                        table.file,
+                                        table.structure,
+                                        [&](const auto& row)
+                                        {
+                                            auto bytes = table.structure.getCHNKSize(row).second;
+                                            if (changed || rowCount >= table.layout.entryCount ||
+                                                bytes > limit - chunkOffset)
+                                            {
+                                                changed = true;
+                                                return;
+                                            }
+
+                                            chunk.clear();
+                                            table.structure.writeEXPA(
+                                                row, data + rowOffset, static_cast<uint32_t>(rowOffset), chunk);
+                                            rowOffset += table.layout.entrySize;
+                                            rowCount++;
+                                            chunkOffset = writeCHNK(data, chunkOffset, chunk);
+                                        });
+            if (!result) return std::unexpected(result.error());
+            if (changed || rowCount != table.layout.entryCount)
+                return std::unexpected(std::format("{} changed during conversion.", table.file.string()));
+        }
+
+        return {};
+    }
+
 } // namespace mvgltools::expa::detail
 
+namespace mvgltools::expa
+{
+    class ColumnTable;
+
+    /**
+     * Represents an EXPA file mapped into memory. Only the table directory is read when opening the file, the rows of a
+     * table are decoded when they are first accessed.
+     *
+     * Accessing the rows is not thread-safe.
+     */
+    class TableFileView
+    {
+    public:
+        /**
+         * Open an EXPA file, reading only its table directory.
+         *
+         * @param path the path to read from
+         * @return the view if successful, an error string otherwise
+         */
+        template<EXPA expa>
+        static auto open(const std::filesystem::path& path) -> std::expected<TableFileView, std::string>;
+
+        [[nodiscard]] auto getTableCount() const -> size_t;
+        [[nodiscard]] auto getName(size_t table) const -> const std::string&;
+        [[nodiscard]] auto getStructure(size_t table) const -> const Structure&;
+        [[nodiscard]] auto getEntryCount(size_t table) const -> uint32_t;
+
+        /**
+         * Find a table by its name.
+         */
+        [[nodiscard]] auto findTable(std::string_view name) const -> std::optional<size_t>;
+
+        /**
+         * Get the rows of a table, decoding them on first access.
+         *
+         * @return the rows if successful, an error string otherwise
+         */
+        auto getEntries(size_t table) -> std::expected<std::span<const std::vector<EntryValue>>, std::string>;
+
+        /**
+         * Decode a table into the columnar layout of ColumnTable.h. Rows are decoded one at a time and not cached.
+         *
+         * @return the table if successful, an error string otherwise
+         */
+        auto getColumnTable(size_t table) -> std::expected<ColumnTable, std::string>;
+
+        /**
+         * Decode all tables into a table file.
+         *
+         * @return the table file if successful, an error string otherwise
+         */
+        auto toTableFile() -> std::expected<TableFile, std::string>;
+
+    private:
+        MappedFile file;
+        detail::EXPADirectory directory;
+        std::vector<std::optional<std::vector<std::vector<EntryValue>>>> entries;
+        std::optional<CHNKLookup> chunks;
+
+        explicit TableFileView(const std::filesystem::path& path);
+
+        auto readChunks() -> std::expected<void, std::string>;
+        [[nodiscard]] auto decode(size_t table) const -> std::vector<std::vector<EntryValue>>;
+    };
+} // namespace mvgltools::expa
+
 // implementation
 namespace mvgltools::expa
 {
@@ -436,177 +1074,233 @@ namespace mvgltools::expa
         if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source))
             return std::unexpected("Source path doesn't exist or is not a directory.");
 
-        const std::filesystem::directory_iterator itr(source);
-        std::vector<std::filesystem::path> files;
-        for (const auto& val : itr)
-            if (val.is_regular_file()) files.push_back(val);
-        std::ranges::sort(files);
-
         std::vector<Table> tables;
-        for (const auto& file : files)
+        for (const auto& file : getCSVFiles(source))
         {
-            const CSVFile csv(file);
+            CSVFile csv(file);
+            if (!csv.isOpen()) return std::unexpected(std::format("Failed to read {}.", file.string()));
 
             auto name      = file.stem().generic_string().substr(4);
             auto structure = getStructureCSV<expa>(csv, source, name);
-            auto entries   = csv.getRows() |
-                           std::views::transform([&](const auto& val) { return structure.readCSV(val); }) |
-                           std::ranges::to<std::vector<std::vector<EntryValue>>>();
 
-            tables.emplace_back(name, structure, entries);
+            std::vector<std::vector<EntryValue>> entries;
+            auto result = forEachCSVRow(csv, file, structure, [&](auto& row) { entries.push_back(std::move(row)); });
+            if (!result) return std::unexpected(result.error());
+
+            tables.emplace_back(name, structure, std::move(entries));
         }
 
         return TableFile{tables};
     }
 
     template<EXPA expa>
-    auto writeEXPA(const TableFile& file, const std::filesystem::path& path) -> std::expected<void, std::string>
+    auto buildEXPA(const TableFile& file) -> std::vector<char>
     {
-        if (std::filesystem::exists(path) && !std::filesystem::is_regular_file(path))
-            return std::unexpected("Target path already exists and is not a file.");
-        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+        // compute the final layout first, so everything can be written into a single buffer
+        std::vector<TableLayout> layout;
+        size_t size         = sizeof(EXPAHeader);
+        size_t chunkSize    = sizeof(CHNKHeader);
+        uint32_t chunkCount = 0;
 
-        std::ofstream stream(path, std::ios::out | std::ios::binary);
+        for (const auto& table : file.tables)
+        {
+            const auto entryCount = static_cast<uint32_t>(table.entries.size());
+            size = layout.emplace_back(getTableLayout<expa>(table.name, table.structure, entryCount, size)).getEnd();
 
-        if (!stream) return std::unexpected("Failed to write target file.");
+            for (const auto& row : table.entries)
+            {
+                auto [count, bytes] = table.structure.getCHNKSize(row);
+                chunkCount += count;
+                chunkSize += bytes;
+            }
+        }
 
-        std::vector<CHNKEntry> chnk;
+        const auto chunkStart = size;
+        std::vector<char> buffer(chunkStart + chunkSize);
+        auto* data = buffer.data();
 
-        write(stream, EXPA_MAGIC);
-        write(stream, static_cast<uint32_t>(file.tables.size()));
+        writeAt(data, 0, EXPAHeader{.tableCount = static_cast<int32_t>(file.tables.size())});
+        auto chunkOffset = writeAt(data, chunkStart, CHNKHeader{.numEntry = chunkCount});
 
-        for (const auto& table : file.tables)
+        std::vector<CHNKReference> chunk;
+        for (const auto& [table, entry] : std::views::zip(file.tables, layout))
         {
-            const auto& structure    = table.structure;
-            const auto nameSize      = ceilInteger(static_cast<int64_t>(table.name.size() + 1), 4);
-            auto structureSize       = structure.getEXPASize();
-            auto actualStructureSize = ceilInteger(structureSize, 8);
-            write(stream, static_cast<int32_t>(nameSize));
-            write(stream, table.name, nameSize);
-
-            if constexpr (expa::HAS_STRUCTURE_SECTION)
+            writeTableHeader<expa>(data, entry, table.name, table.structure);
+
+            auto rowOffset = entry.dataOffset;
+            for (const auto& row : table.entries)
             {
-                write(stream, static_cast<uint32_t>(structure.getEntryCount()));
-                for (const auto& entry : structure.getStructure())
-                    write(stream, entry.type);
+                chunk.clear();
+                table.structure.writeEXPA(row, data + rowOffset, static_cast<uint32_t>(rowOffset), chunk);
+                rowOffset += entry.entrySize;
+                chunkOffset = writeCHNK(data, chunkOffset, chunk);
             }
+        }
 
-            write(stream, structureSize);
-            write(stream, static_cast<uint32_t>(table.entries.size()));
-
-            stream.seekp(ceilInteger(stream.tellp(), 8), std::ios::beg);
+        return buffer;
+    }
 
-            for (const auto& entry : table.entries)
-            {
-                auto start  = stream.tellp();
-                auto result = structure.writeEXPA(entry);
-                write(stream, result.data);
+    template<EXPA expa>
+    auto writeEXPA(const TableFile& file, const std::filesystem::path& path) -> std::expected<void, std::string>
+    {
+        if (std::filesystem::exists(path) && !std::filesystem::is_regular_file(path))
+            return std::unexpected("Target path already exists and is not a file.");
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
 
-                auto lambda = [=](CHNKEntry& val)
-                {
-                    val.offset += static_cast<uint32_t>(start);
-                    return val;
-                };
+        const auto buffer = buildEXPA<expa>(file);
 
-                chnk.append_range(std::ranges::views::transform(result.chunk, lambda));
-            }
-        }
+        std::ofstream stream(path, std::ios::out | std::ios::binary);
+        if (!stream) return std::unexpected("Failed to write target file.");
 
-        write(stream, CHNK_MAGIC);
-        write(stream, static_cast<uint32_t>(chnk.size()));
-        for (const auto& entry : chnk)
-        {
-            write(stream, entry.offset);
-            write(stream, static_cast<uint32_t>(entry.value.size()));
-            write(stream, entry.value);
-        }
+        write(stream, buffer);
+        if (!stream) return std::unexpected("Failed to write target file.");
 
         return {};
     }
 
+    template<EXPA expa>
+    auto TableFileView::open(const std::filesystem::path& path) -> std::expected<TableFileView, std::string>
+    {
+        if (!std::filesystem::exists(path)) return std::unexpected("Source path does not exist.");
+        if (!std::filesystem::is_regular_file(path)) return std::unexpected("Source path does not lead to a file.");
+
+        TableFileView view(path);
+        if (!view.file.isOpen()) return std::unexpected("Failed to read source file.");
+
+        auto directory = readEXPADirectory<expa>(view.file.data(), path);
+        if (!directory) return std::unexpected(directory.error());
+
+        view.directory = std::move(directory.value());
+        view.entries.resize(view.directory.tables.size());
+        return view;
+    }
+
     template<EXPA expa>
     auto readEXPA(const std::filesystem::path& path) -> std::expected<TableFile, std::string>
     {
-        struct TableEntry
-        {
-            std::string name;
-            size_t dataOffset{};
-            uint32_t entryCount{};
-            uint32_t entrySize{};
-            Structure structure;
-        };
+        auto view = TableFileView::open<expa>(path);
+        if (!view) return std::unexpected(view.error());
+
+        return view->toTableFile();
+    }
 
+    template<EXPA expa>
+    auto readEXPAStructures(const std::filesystem::path& path)
+        -> std::expected<std::vector<std::pair<std::string, Structure>>, std::string>
+    {
         if (!std::filesystem::exists(path)) return std::unexpected("Source path does not exist.");
         if (!std::filesystem::is_regular_file(path)) return std::unexpected("Source path does not lead to a file.");
 
-        std::ifstream stream(path, std::ios::in | std::ios::binary);
+        const MappedFile file(path);
+        if (!file.isOpen()) return std::unexpected("Failed to read source file.");
 
-        if (!stream) return std::unexpected("Failed to read source file.");
+        auto directory = readEXPADirectory<expa>(file.data(), path);
+        if (!directory) return std::unexpected(directory.error());
 
-        std::vector<char> content(std::filesystem::file_size(path));
-        stream.read(content.data(), static_cast<std::streamsize>(content.size()));
-        stream.seekg(std::ios::beg);
+        std::vector<std::pair<std::string, Structure>> structures;
+        for (auto& table : directory->tables)
+            structures.emplace_back(std::move(table.name), std::move(table.structure));
 
-        const auto header = read<EXPAHeader>(stream);
-        if (header.magic != EXPA_MAGIC) return std::unexpected("Source file lacks EXPA header.");
+        return structures;
+    }
 
-        std::vector<TableEntry> tables;
+    template<EXPA expa>
+    auto convertEXPAToCSV(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<void, std::string>
+    {
+        if (!std::filesystem::exists(source)) return std::unexpected("Source path does not exist.");
+        if (!std::filesystem::is_regular_file(source)) return std::unexpected("Source path does not lead to a file.");
 
-        for (int32_t i = 0; i < header.tableCount; i++)
-        {
-            alignStream<expa::ALIGN_STEP>(stream);
+        const MappedFile file(source);
+        if (!file.isOpen()) return std::unexpected("Failed to read source file.");
 
-            auto nameLength = read<uint32_t>(stream);
-            std::vector<char> nameData(nameLength);
-            stream.read(nameData.data(), static_cast<std::streamsize>(nameData.size()));
-            std::string name(nameData.data());
+        return convertEXPAToCSV<expa>(file.data(), source, target);
+    }
 
-            Structure structure = getStructure<expa>(stream, path, name);
-            auto entrySize      = read<uint32_t>(stream);
-            auto entryCount     = read<uint32_t>(stream);
+    template<EXPA expa>
+    auto convertEXPAToCSV(std::span<const char> data,
+                          const std::filesystem::path& path,
+                          const std::filesystem::path& target) -> std::expected<void, std::string>
+    {
+        if (std::filesystem::exists(target) && !std::filesystem::is_directory(target))
+            return std::unexpected("Target path exists and is not a directory.");
 
-            alignStream<8>(stream);
-            tables.emplace_back(name, stream.tellg(), entryCount, entrySize, structure);
-            stream.seekg(entryCount * ceilInteger(entrySize, 8), std::ios::cur);
+        auto directory = readEXPADirectory<expa>(data, path);
+        if (!directory) return std::unexpected(directory.error());
 
-            auto structureSize = structure.getEXPASize();
-            if (structureSize != ceilInteger(entrySize, 8))
-            {
-                return std::unexpected(
-                    std::format("Structure size {} doesn't match entry size {}.", structureSize, entrySize));
-            }
+        auto chunks = CHNKLookup::read(data, directory->chunkOffset);
+        if (!chunks) return std::unexpected(chunks.error());
+
+        std::filesystem::create_directories(target);
+
+        int32_t table_id = 0;
+        for (const auto& table : directory->tables)
+        {
+            auto file = target / std::format("{:03}_{}.csv", table_id++, table.name);
+            std::ofstream stream(file, std::ios::out);
+
+            if (!stream) return std::unexpected("Failed to write target file.");
+
+            CSVWriter writer(stream);
+            table.structure.writeCSVHeader(writer);
+            for (uint32_t i = 0; i < table.entryCount; i++)
+                table.structure.writeCSV(data.data() + table.getRowOffset(i), chunks.value(), writer);
         }
 
-        alignStream<expa::ALIGN_STEP>(stream);
+        return {};
+    }
 
-        const auto chunkHeader = read<CHNKHeader>(stream);
-        if (chunkHeader.magic != CHNK_MAGIC) return std::unexpected("Source file lacks CHNK header.");
+    template<EXPA expa>
+    auto convertCSVToEXPA(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<void, std::string>
+    {
+        if (std::filesystem::exists(target) && !std::filesystem::is_regular_file(target))
+            return std::unexpected("Target path already exists and is not a file.");
 
-        for (uint32_t i = 0; i < chunkHeader.numEntry; i++)
+        const auto tempPath = std::filesystem::path(target).concat(".tmp");
+        std::optional<MappedFile> output;
+        auto allocate = [&](size_t size) -> std::span<char>
         {
-            auto offset = read<uint32_t>(stream);
-            auto size   = read<uint32_t>(stream);
-            auto ptr    = reinterpret_cast<uint64_t>(content.data() + stream.tellg());
-            *reinterpret_cast<uint64_t*>(content.data() + offset) = ptr;
-            stream.seekg(size, std::ios::cur);
+            if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path());
+
+            output.emplace(MappedFile::create(tempPath, size));
+            if (!output->isOpen()) return {};
+            return output->data();
+        };
+
+        auto result = writeCSVAsEXPA<expa>(source, allocate);
+        output.reset();
+
+        std::error_code error;
+        if (!result)
+        {
+            std::filesystem::remove(tempPath, error);
+            return result;
         }
 
-        std::vector<Table> finalTable;
-        for (const auto& table : tables)
+        std::filesystem::rename(tempPath, target, error);
+        if (error)
         {
-            const auto increase = ceilInteger(table.entrySize, 8);
-            auto offset         = table.dataOffset;
-            std::vector<std::vector<EntryValue>> values;
+            std::filesystem::remove(tempPath, error);
+            return std::unexpected("Failed to write target file.");
+        }
 
-            for (uint32_t i = 0; i < table.entryCount; i++)
-            {
-                values.push_back(table.structure.readEXPA(content.data() + offset));
-                offset += increase;
-            }
+        return {};
+    }
 
-            finalTable.emplace_back(table.name, table.structure, values);
-        }
+    template<EXPA expa>
+    auto convertCSVToEXPA(const std::filesystem::path& source) -> std::expected<std::vector<char>, std::string>
+    {
+        std::vector<char> buffer;
+        auto allocate = [&](size_t size) -> std::span<char>
+        {
+            buffer.resize(size);
+            return buffer;
+        };
+
+        auto result = writeCSVAsEXPA<expa>(source, allocate);
+        if (!result) return std::unexpected(result.error());
 
-        return TableFile{finalTable};
+        return buffer;
     }
-} // namespace mvgltools::expa
\ No newline at end of file
+} // namespace mvgltools::expa
@@ -1,13 +1,30 @@
 #pragma once
 
 #include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#endif
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -31,8 +48,11 @@ namespace mvgltools
         std::cout << str << '\n';
     }
 
-    template<typename T>
-    inline auto read(std::ifstream& stream) -> T
+    /**
+     * Read a T from the stream. The stream type is kept, so derived streams that hide read (e.g. to decrypt) are used.
+     */
+    template<typename T, typename Stream = std::ifstream>
+    inline auto read(Stream& stream) -> T
     {
         T data;
         stream.read(reinterpret_cast<char*>(&data), sizeof(T));
@@ -62,6 +82,21 @@ namespace mvgltools
         stream.write(copy.data(), static_cast<std::streamsize>(copy.size()));
     }
 
+    template<typename T>
+    inline auto writeAt(char* buffer, size_t offset, const T& data) -> size_t
+    {
+        std::memcpy(buffer + offset, &data, sizeof(T));
+        return offset + sizeof(T);
+    }
+
+    template<typename T>
+    inline auto readAt(const char* buffer, size_t offset) -> T
+    {
+        T data;
+        std::memcpy(&data, buffer + offset, sizeof(T));
+        return data;
+    }
+
     inline auto getChecksum(const std::vector<char>& data) -> uint32_t
     {
         boost::crc_32_type crc;
@@ -69,6 +104,16 @@ namespace mvgltools
         return crc.checksum();
     }
 
+    /**
+     * Calculate the CRC-64 of the given data, as used by XZ.
+     */
+    inline auto getChecksum64(const std::vector<char>& data) -> uint64_t
+    {
+        boost::crc_optimal<64, 0x42F0E1EBA9EA3693, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, true, true> crc;
+        crc.process_bytes(data.data(), data.size());
+        return crc.checksum();
+    }
+
     constexpr auto trim(std::string_view view) -> std::string_view
     {
         auto firstNull  = view.find_first_of('\0');
@@ -89,6 +134,243 @@ namespace mvgltools
         stream.seekg(ceilInteger(stream.tellg(), step));
     }
 
+    /**
+     * Represents a file mapped into memory. If the file can't be mapped it is considered not open, empty files are open
+     * but have no data.
+     *
+     * Existing files are mapped read-only, only files made by create may be written to.
+     */
+    class MappedFile
+    {
+    private:
+        boost::interprocess::file_mapping mapping;
+        boost::interprocess::mapped_region region;
+        bool open{false};
+
+        MappedFile() = default;
+
+    public:
+        explicit MappedFile(const std::filesystem::path& path)
+        {
+            try
+            {
+                if (std::filesystem::file_size(path) != 0)
+                {
+                    mapping = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+                    region  = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+                }
+                open = true;
+            }
+            catch (std::exception&)
+            {
+                open = false;
+            }
+        }
+
+        /**
+         * Create a file of the given size, filled with zeroes, and map it writable into memory. An existing file gets
+         * overwritten.
+         */
+        static auto create(const std::filesystem::path& path, size_t size) -> MappedFile
+        {
+            MappedFile file;
+            try
+            {
+                std::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!stream) return file;
+                stream.close();
+
+                std::filesystem::resize_file(path, size);
+                if (size != 0)
+                {
+                    file.mapping = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_write);
+                    file.region  = boost::interprocess::mapped_region(file.mapping, boost::interprocess::read_write);
+                }
+                file.open = true;
+            }
+            catch (std::exception&)
+            {
+                file.open = false;
+            }
+            return file;
+        }
+
+        [[nodiscard]] auto isOpen() const -> bool { return open; }
+        [[nodiscard]] auto size() const -> size_t { return region.get_size(); }
+        [[nodiscard]] auto data() const -> std::span<const char>
+        {
+            return {static_cast<const char*>(region.get_address()), region.get_size()};
+        }
+        [[nodiscard]] auto data() -> std::span<char>
+        {
+            return {static_cast<char*>(region.get_address()), region.get_size()};
+        }
+    };
+
+    /**
+     * Tells the OS which parts of a file are going to be read soon, so it can read them ahead of time. Does nothing on
+     * platforms without posix_fadvise.
+     */
+    class ReadaheadHint
+    {
+    private:
+        [[maybe_unused]] int fd{-1};
+
+    public:
+        explicit ReadaheadHint([[maybe_unused]] const std::filesystem::path& path)
+        {
+#ifdef POSIX_FADV_WILLNEED
+            fd = ::open(path.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+#endif
+        }
+
+        ReadaheadHint(const ReadaheadHint&)                    = delete;
+        auto operator=(const ReadaheadHint&) -> ReadaheadHint& = delete;
+
+        ~ReadaheadHint()
+        {
+#ifdef POSIX_FADV_WILLNEED
+            if (fd != -1) ::close(fd);
+#endif
+        }
+
+        void willNeed([[maybe_unused]] uint64_t offset, [[maybe_unused]] uint64_t size)
+        {
+#ifdef POSIX_FADV_WILLNEED
+            if (fd != -1)
+                ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#endif
+        }
+    };
+
+    /**
+     * Create a copy of a file that shares the data on disk with the source (reflink), e.g. on Btrfs or XFS. An
+     * existing target gets replaced, without writing into other hardlinks of it.
+     *
+     * @return whether the copy was created, false if not supported by the platform or the file system
+     */
+    inline auto cloneFile([[maybe_unused]] const std::filesystem::path& source,
+                          [[maybe_unused]] const std::filesystem::path& target) -> bool
+    {
+#ifdef FICLONE
+        auto input = ::open(source.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (input == -1) return false;
+
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-vararg)
+        ::unlink(target.c_str());
+        auto output  = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+        auto success = output != -1 && ::ioctl(output, FICLONE, input) == 0;
+        // NOLINTEND(cppcoreguidelines-pro-type-vararg)
+
+        ::close(input);
+        if (output != -1) ::close(output);
+        if (!success && output != -1) std::filesystem::remove(target);
+        return success;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Copy a range of the source file into the target file without passing the data through user space, using
+     * copy_file_range or sendfile. The target gets created if it doesn't exist, but is not truncated.
+     *
+     * @return whether the whole range was copied, false if not supported by the platform or the file systems
+     */
+    inline auto copyFileRange([[maybe_unused]] const std::filesystem::path& source,
+                              [[maybe_unused]] uint64_t sourceOffset,
+                              [[maybe_unused]] const std::filesystem::path& target,
+                              [[maybe_unused]] uint64_t targetOffset,
+                              [[maybe_unused]] uint64_t size) -> bool
+    {
+#ifdef __linux__
+        auto input = ::open(source.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (input == -1) return false;
+
+        auto output = ::open(target.c_str(), O_WRONLY | O_CREAT, 0666); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (output == -1)
+        {
+            ::close(input);
+            return false;
+        }
+
+        auto inOffset  = static_cast<off_t>(sourceOffset);
+        auto outOffset = static_cast<off_t>(targetOffset);
+        while (size > 0)
+        {
+            auto copied = ::copy_file_range(input, &inOffset, output, &outOffset, size, 0);
+            if (copied <= 0) break;
+            size -= copied;
+        }
+
+        // older kernels can't copy between file systems, sendfile writes at the current position of the target
+        if (size > 0 && ::lseek(output, outOffset, SEEK_SET) == outOffset)
+        {
+            while (size > 0)
+            {
+                auto copied = ::sendfile(output, input, &inOffset, size);
+                if (copied <= 0) break;
+                size -= copied;
+            }
+        }
+
+        ::close(input);
+        ::close(output);
+        return size == 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Make sure everything written to a file so far is stored on the disk, so it can't get lost while later writes
+     * make it. Writes through a stream need to be flushed before.
+     */
+    inline void syncFile([[maybe_unused]] const std::filesystem::path& path)
+    {
+#ifdef __unix__
+        auto file = ::open(path.c_str(), O_WRONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (file == -1) return;
+
+        ::fsync(file);
+        ::close(file);
+#endif
+    }
+
+    /**
+     * Write a range of the source file to stdout without passing the data through user space, using splice if stdout
+     * is a pipe and sendfile otherwise. Data buffered in std::cout needs to be flushed before.
+     *
+     * @return the number of bytes written, less than size if not supported by the platform or the kind of stdout
+     */
+    inline auto sendToStdout([[maybe_unused]] const std::filesystem::path& source,
+                             [[maybe_unused]] uint64_t sourceOffset,
+                             [[maybe_unused]] uint64_t size) -> uint64_t
+    {
+#ifdef __linux__
+        auto input = ::open(source.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        if (input == -1) return 0;
+
+        struct stat status{};
+        const auto isPipe = ::fstat(STDOUT_FILENO, &status) == 0 && S_ISFIFO(status.st_mode);
+
+        auto offset      = static_cast<off_t>(sourceOffset);
+        uint64_t written = 0;
+        while (written < size)
+        {
+            auto count = isPipe ? ::splice(input, &offset, STDOUT_FILENO, nullptr, size - written, SPLICE_F_MORE)
+                                : ::sendfile(STDOUT_FILENO, input, &offset, size - written);
+            if (count <= 0) break;
+            written += count;
+        }
+
+        ::close(input);
+        return written;
+#else
+        return 0;
+#endif
+    }
+
     constexpr auto wrapRegex(const std::string& in) -> std::string
     {
         return "^" + in + "$";
@@ -1,30 +1,44 @@
 #pragma once
+#include "AsyncIO.h"
 #include "Compressors.h"
 #include "Helpers.h"
+#include "Tar.h"
 
 #include <boost/asio.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <boost/regex.hpp>
 
 #include <algorithm>
 #include <array>
-#include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <expected>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <ios>
 #include <iosfwd>
+#include <iostream>
 #include <istream>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <ranges>
+#include <set>
+#include <span>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace mvgltools::mdb1
@@ -53,6 +67,176 @@ namespace mvgltools::mdb1
         ADVANCED
     };
 
+    /**
+     * Represents the ways to write files sharing their data with another file when extracting MDB1 files.
+     */
+    enum class DuplicateMode
+    {
+        /**
+         * Write a full copy of the data for every file.
+         */
+        COPY,
+        /**
+         * Create a copy sharing the data on disk (reflink), if the file system supports it. Copy otherwise.
+         */
+        REFLINK,
+        /**
+         * Like REFLINK, but create a hardlink instead of copying. Changing one of the files changes all of them!
+         */
+        HARDLINK,
+    };
+
+    /**
+     * Represents a file as stored within a MDB1 archive.
+     */
+    struct RawFile
+    {
+        /**
+         * The uncompressed size of the file.
+         */
+        uint64_t fullSize;
+        /**
+         * The stored data of the file, compressed unless its size equals fullSize.
+         */
+        std::vector<char> data;
+    };
+
+    /**
+     * Represents the sizes of a file within a MDB1 archive.
+     */
+    struct FileInfo
+    {
+        uint64_t fullSize;
+        uint64_t compressedSize;
+        /**
+         * The data entry the file refers to, files with the same one share their stored data.
+         */
+        uint64_t dataId;
+    };
+
+    /**
+     * Loads the uncompressed data of a file to be packed into a MDB1 archive.
+     */
+    using FileLoader = std::function<std::expected<std::vector<char>, std::string>()>;
+
+    /**
+     * Loads the stored data of a file to be packed into a MDB1 archive, e.g. from another archive.
+     */
+    using RawFileLoader = std::function<std::expected<RawFile, std::string>()>;
+
+    /**
+     * Represents a file to be packed into a MDB1 archive.
+     */
+    struct ArchiveFile
+    {
+        /**
+         * The path of the file within the archive.
+         */
+        std::filesystem::path path;
+        /**
+         * Loads the uncompressed data of the file, called when the file gets compressed.
+         */
+        FileLoader load;
+        /**
+         * Alternative to load, if set the data it loads gets written as is, without compressing it again.
+         */
+        RawFileLoader loadRaw;
+        /**
+         * The file on disk load reads, if any. Files that don't get compressed are copied from it directly.
+         */
+        std::filesystem::path source;
+        /**
+         * Identifies the stored data loadRaw reads, e.g. a source archive and data entry. Files with the same key
+         * share one data entry, their data is only loaded and written once.
+         */
+        std::optional<std::pair<size_t, uint64_t>> sharedData;
+    };
+
+    /**
+     * Selects files of an archive by their path within it. A file is selected if it matches no exclude pattern and
+     * any include pattern, or there are no include patterns at all. Paths are matched using '/' as separator.
+     */
+    class FileFilter
+    {
+    public:
+        /**
+         * Add a glob pattern. '*' and '?' match anything but '/', '**' also matches '/' and [...] matches any of the
+         * given characters. Patterns without a '/' are matched against the file name only.
+         *
+         * @return void if successful, an error string if the pattern is invalid
+         */
+        auto addGlob(std::string_view pattern, bool exclude = false) -> std::expected<void, std::string>;
+
+        /**
+         * Add a regular expression, it matches if it's found anywhere within the path.
+         *
+         * @return void if successful, an error string if the expression is invalid
+         */
+        auto addRegex(const std::string& pattern, bool exclude = false) -> std::expected<void, std::string>;
+
+        /**
+         * Add the exact path of a file.
+         */
+        void addName(std::string name, bool exclude = false);
+
+        /**
+         * Check whether the file with the given path is selected, both '/' and '\\' are accepted as separator.
+         */
+        [[nodiscard]] auto matches(std::string path) const -> bool;
+
+        /**
+         * Whether the filter selects every file, i.e. nothing has been added to it.
+         */
+        [[nodiscard]] auto isEmpty() const -> bool;
+
+    private:
+        std::vector<boost::regex> includes;
+        std::vector<boost::regex> excludes;
+        std::set<std::string> includedNames;
+        std::set<std::string> excludedNames;
+    };
+
+    /**
+     * Represents the options for extracting MDB1 files.
+     */
+    struct ExtractOptions
+    {
+        /**
+         * Selects the files to extract, by default all of them.
+         */
+        FileFilter filter;
+        /**
+         * The number of files to extract at once, 0 uses the number of available cores.
+         */
+        uint32_t jobs{0};
+        /**
+         * How to create files sharing their data with another file.
+         */
+        DuplicateMode duplicates{DuplicateMode::REFLINK};
+        /**
+         * If set, the size and checksum of the stored data of every extracted file gets recorded in this file.
+         * Files whose data didn't change since the last time get skipped, without decompressing them.
+         */
+        std::filesystem::path manifest;
+    };
+
+    /**
+     * Represents the outcome of verifying a MDB1 archive.
+     */
+    struct VerifyResult
+    {
+        size_t fileCount;
+        size_t dataCount;
+        /**
+         * The total size of all checked data, after decompression.
+         */
+        uint64_t fullSize;
+        /**
+         * Every problem found in the archive, the archive is fine if this is empty.
+         */
+        std::vector<std::string> errors;
+    };
+
     /**
      * Represents the archive info, primarily the file list, extracted from a MDB1 file.
      */
@@ -67,12 +251,32 @@ namespace mvgltools::mdb1
         explicit ArchiveInfo(const std::filesystem::path& path);
 
         /**
-         * Extract all files in the archive into the given folder.
+         * Whether the path could be read as a MDB1 file, with intact file tables.
+         */
+        [[nodiscard]] auto isValid() const -> bool;
+
+        /**
+         * Extract the files in the archive into the given folder. The files get decompressed and written in parallel.
+         * Data shared by multiple files only gets decompressed and written once, the other files become copies of it.
          *
          * @param output the folder to write the files into, if it doesn't exist it'll get created
+         * @param options the files to extract and how to do it, see ExtractOptions
+         * @return void if successful, an error string otherwise
+         */
+        auto extract(const std::filesystem::path& output, const ExtractOptions& options = {})
+            -> std::expected<void, std::string>;
+
+        /**
+         * Extract the files in the archive as a tar stream, in the order their data is stored in. The files get
+         * decompressed in parallel, but are written sequentially, so the stream can be piped.
+         * Files sharing their data become hard links with DuplicateMode::HARDLINK, full copies otherwise. The
+         * manifest option isn't supported.
+         *
+         * @param output the stream to write the tar to, opened in binary mode
+         * @param options the files to extract and how to do it, see ExtractOptions
          * @return void if successful, an error string otherwise
          */
-        auto extract(const std::filesystem::path& output) -> std::expected<void, std::string>;
+        auto extractTar(std::ostream& output, const ExtractOptions& options = {}) -> std::expected<void, std::string>;
 
         /**
          * Extract a single files from the archive into the given file.
@@ -83,20 +287,178 @@ namespace mvgltools::mdb1
         auto extractSingleFile(const std::filesystem::path& output, std::string file)
             -> std::expected<void, std::string>;
 
+        /**
+         * Extract a single file from the archive to stdout, with the same data as written by extractSingleFile.
+         * Stored data gets passed to stdout by the kernel where possible, other data is decompressed in memory.
+         * On Windows stdout needs to be switched to binary mode before.
+         *
+         * @return void if successful, an error string otherwise
+         */
+        auto extractSingleFileToStdout(std::string file) -> std::expected<void, std::string>;
+
+        /**
+         * Get the paths of all files in the archive, using backslashes as separator.
+         */
+        [[nodiscard]] auto getFiles() const -> std::vector<std::string>;
+
+        /**
+         * Get the sizes of a single file in the archive, without reading it.
+         *
+         * @param file the path of the file within the archive
+         * @return the sizes if the file exists, nothing otherwise
+         */
+        [[nodiscard]] auto getFileInfo(std::string file) const -> std::optional<FileInfo>;
+
+        /**
+         * Read a single file from the archive into memory. The data is the same as written by extractSingleFile.
+         * Safe to be called from multiple threads, the files get decompressed in parallel.
+         *
+         * @param file the path of the file within the archive
+         * @return the file data if successful, an error string otherwise
+         */
+        auto readFile(std::string file) -> std::expected<std::vector<char>, std::string>;
+
+        /**
+         * Read a single file from the archive as it's stored, without decompressing it. Safe to be called from
+         * multiple threads.
+         *
+         * @param file the path of the file within the archive
+         * @return the stored file data if successful, an error string otherwise
+         */
+        auto readRawFile(std::string file) -> std::expected<RawFile, std::string>;
+
+        /**
+         * Check the archive for consistency, without writing anything. The header and file tables get validated, then
+         * all stored data gets decompressed in parallel and compared with its expected size.
+         *
+         * @param jobs the number of threads to decompress with, 0 uses the number of available cores
+         * @return the verification results if the archive could be read, an error string otherwise
+         */
+        auto verify(uint32_t jobs = 0) -> std::expected<VerifyResult, std::string>;
+
     private:
         struct ArchiveEntry
         {
             uint64_t offset;
             uint64_t fullSize;
             uint64_t compressedSize;
+            uint64_t dataId;
+
+            // entries with the same stored data are equal, even if they use separate data entries
+            friend auto operator==(const ArchiveEntry& self, const ArchiveEntry& other) -> bool
+            {
+                return self.offset == other.offset && self.fullSize == other.fullSize &&
+                       self.compressedSize == other.compressedSize;
+            }
         };
 
+        std::filesystem::path path;
         MDB::InputStream input;
+        std::mutex inputMutex;
         std::map<std::string, ArchiveEntry> entries;
         uint64_t dataStart;
+        bool valid{false};
 
+        auto selectEntries(const FileFilter& filter) const -> std::vector<std::pair<std::string, ArchiveEntry>>;
+        auto readEntry(const ArchiveEntry& entry) -> std::expected<std::vector<char>, std::string>;
+        auto readRawEntry(const ArchiveEntry& entry) -> std::expected<std::vector<char>, std::string>;
         auto extractFile(const std::filesystem::path& output, const ArchiveEntry& entry)
             -> std::expected<void, std::string>;
+        auto writeFile(const std::filesystem::path& output, std::vector<char>& data)
+            -> std::expected<void, std::string>;
+        auto copyStoredFile(const std::filesystem::path& output, const ArchiveEntry& entry)
+            -> std::expected<void, std::string>;
+    };
+
+    /**
+     * Represents the outcome of updating a MDB1 archive.
+     */
+    struct UpdateResult
+    {
+        size_t addedFiles;
+        size_t replacedFiles;
+        /**
+         * Whether the whole archive had to be rewritten, because the new tables didn't fit in front of the data.
+         */
+        bool rewritten;
+    };
+
+    /**
+     * Collects files from disk, memory or generated on demand and packs them into a new MDB1 archive. The resulting
+     * archive is identical to one packed from a folder with the same contents.
+     */
+    template<ArchiveType MDB>
+    class ArchiveBuilder
+    {
+    public:
+        /**
+         * Add a file from disk, it gets read when it's compressed.
+         *
+         * @param path the path of the file within the archive
+         * @param source the file on disk
+         */
+        void addFile(std::filesystem::path path, std::filesystem::path source);
+
+        /**
+         * Add a file from memory.
+         *
+         * @param path the path of the file within the archive
+         * @param data the uncompressed data of the file
+         */
+        void addBuffer(std::filesystem::path path, std::vector<char> data);
+
+        /**
+         * Add a file that gets generated when it's compressed, e.g. by converting another file.
+         *
+         * @param path the path of the file within the archive
+         * @param load the function returning the uncompressed data of the file
+         */
+        void addGenerated(std::filesystem::path path, FileLoader load);
+
+        /**
+         * Add a file that's already stored in archive format, e.g. read from another archive using
+         * ArchiveInfo::readRawFile. Its data is written without compressing it again.
+         *
+         * @param path the path of the file within the archive
+         * @param load the function returning the stored data of the file
+         */
+        void addRaw(std::filesystem::path path, RawFileLoader load);
+
+        /**
+         * Add all files within a folder, recursively, using their path relative to the folder.
+         *
+         * @param source the folder to add
+         * @return void if successful, an error string otherwise
+         */
+        auto addDirectory(const std::filesystem::path& source) -> std::expected<void, std::string>;
+
+        [[nodiscard]] auto getFileCount() const -> size_t;
+
+        /**
+         * Pack all added files into a new archive. The builder is empty afterwards.
+         *
+         * @param target the file to write the data into, if it doesn't exist it'll get created
+         * @param compress the compress mode to be used
+         * @param reserve the number of additional files to reserve table space for, see updateArchive
+         * @return void if successful, an error string otherwise
+         */
+        auto build(const std::filesystem::path& target, CompressMode compress, size_t reserve = 0)
+            -> std::expected<void, std::string>;
+
+        /**
+         * Add all added files to an existing archive, replacing files with the same path. The builder is empty
+         * afterwards.
+         *
+         * @param archive the archive to update
+         * @param compress the compress mode to be used
+         * @param reserve the number of additional files to reserve table space for, if the archive must be rewritten
+         * @return the number of added and replaced files if successful, an error string otherwise
+         */
+        auto update(const std::filesystem::path& archive, CompressMode compress, size_t reserve = 0)
+            -> std::expected<UpdateResult, std::string>;
+
+    private:
+        std::vector<ArchiveFile> files;
     };
 
     /**
@@ -105,11 +467,153 @@ namespace mvgltools::mdb1
      * @param output the folder to create the archive from
      * @param target the file to write the data into, if it doesn't exist it'll get created
      * @param compress the compress mode to be used
+     * @param reserve the number of additional files to reserve table space for, see updateArchive
      * @return void if successful, an error string otherwise
      */
     template<ArchiveType MDB>
-    auto packArchive(const std::filesystem::path& source, const std::filesystem::path& target, CompressMode compress)
-        -> std::expected<void, std::string>;
+    auto packArchive(const std::filesystem::path& source,
+                     const std::filesystem::path& target,
+                     CompressMode compress,
+                     size_t reserve = 0) -> std::expected<void, std::string>;
+
+    /**
+     * Created a new MDB1 archive from a list of files, which don't need to exist on disk. The files are ordered by
+     * their path, they get loaded and compressed in parallel.
+     *
+     * @param files the files to create the archive from
+     * @param target the file to write the data into, if it doesn't exist it'll get created
+     * @param compress the compress mode to be used
+     * @param reserve the number of additional files to reserve table space for, see updateArchive
+     * @return void if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto packArchive(std::vector<ArchiveFile> files,
+                     const std::filesystem::path& target,
+                     CompressMode compress,
+                     size_t reserve = 0) -> std::expected<void, std::string>;
+
+    /**
+     * Add files to an existing MDB1 archive, replacing files with the same path. Only the given files get compressed,
+     * their data is appended to the archive and the tables get rebuilt. The old data of replaced files stays in the
+     * archive, use compactArchive to remove it.
+     *
+     * The tables are stored in front of the data. If the new tables and room for the given number of additional files
+     * don't fit there, the whole archive gets rewritten with the data moved back. When updating in place, the new data
+     * and tables are synced to the disk before the header gets switched.
+     *
+     * @param archive the archive to update
+     * @param files the files to add
+     * @param compress the compress mode to be used, ADVANCED isn't supported since the data doesn't get deduplicated
+     * @param reserve the number of additional files the tables must have room for after the update
+     * @return the number of added and replaced files if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto updateArchive(const std::filesystem::path& archive,
+                       std::vector<ArchiveFile> files,
+                       CompressMode compress,
+                       size_t reserve = 0) -> std::expected<UpdateResult, std::string>;
+
+    /**
+     * Merge multiple MDB1 archives and folders into a new MDB1 archive. If a file exists in multiple sources, the one
+     * from the later source is used. Files from archives are copied as they are stored, without recompressing them.
+     *
+     * @param sources the archives and folders to merge, in ascending priority
+     * @param target the file to write the data into, if it doesn't exist it'll get created
+     * @param compress the compress mode to be used for files from folders
+     * @return void if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto mergeArchives(const std::vector<std::filesystem::path>& sources,
+                       const std::filesystem::path& target,
+                       CompressMode compress) -> std::expected<void, std::string>;
+
+    /**
+     * Represents the outcome of compacting a MDB1 archive.
+     */
+    struct CompactResult
+    {
+        size_t removedEntries;
+        size_t mergedEntries;
+        uint64_t oldSize;
+        uint64_t newSize;
+    };
+
+    /**
+     * Create a compacted copy of a MDB1 archive. Data no file refers to gets removed, the remaining data gets stored
+     * contiguously in its original order. The data is copied as stored, without recompressing it, and the file tree
+     * is kept as is.
+     *
+     * @param source the archive to compact
+     * @param target the file to write the data into, if it doesn't exist it'll get created
+     * @param deduplicate whether identical data should be stored only once
+     * @return the number of removed/merged data entries and the file sizes if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto compactArchive(const std::filesystem::path& source, const std::filesystem::path& target, bool deduplicate)
+        -> std::expected<CompactResult, std::string>;
+
+    /**
+     * Represents the changes stored in a patch between two MDB1 archives.
+     */
+    struct PatchSummary
+    {
+        size_t addedFiles;
+        size_t removedFiles;
+        size_t replacedFiles;
+        /**
+         * The total size of the stored data of added and replaced files.
+         */
+        uint64_t dataSize;
+    };
+
+    /**
+     * Create a patch file containing the changes between two MDB1 archives. Files are compared by their stored data,
+     * the patch contains the stored data of added and replaced files. Nothing gets decompressed.
+     *
+     * @param base the archive the patch gets applied to
+     * @param archive the archive the patch should result in
+     * @param patch the file to write the patch into, if it doesn't exist it'll get created
+     * @return a summary of the changes if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto createPatch(const std::filesystem::path& base,
+                     const std::filesystem::path& archive,
+                     const std::filesystem::path& patch) -> std::expected<PatchSummary, std::string>;
+
+    /**
+     * Apply a patch created by createPatch, writing the resulting archive into a new file. The stored data of all
+     * files is copied as is.
+     *
+     * @param base the archive to apply the patch to, it must be the one the patch was created for
+     * @param patch the patch to apply
+     * @param target the file to write the resulting archive into, if it doesn't exist it'll get created
+     * @return a summary of the changes if successful, an error string otherwise
+     */
+    template<ArchiveType MDB>
+    auto applyPatch(const std::filesystem::path& base,
+                    const std::filesystem::path& patch,
+                    const std::filesystem::path& target) -> std::expected<PatchSummary, std::string>;
+
+    /**
+     * Represents the asset encryption of a DSCS archive. The PC release encrypts its archives, all other releases
+     * don't.
+     */
+    enum class ArchiveEncryption
+    {
+        PLAIN,
+        ENCRYPTED
+    };
+
+    /**
+     * Convert a DSCS archive between the encrypted PC and the plain console layout. The direction is picked by the
+     * archive's magic value. The whole file is streamed through the keystream once, nothing gets decompressed.
+     *
+     * @param source the DSCS or DSCSNoCrypt archive to convert
+     * @param target the file to write the converted archive into, if it doesn't exist it'll get created
+     * @return the encryption of the written archive if successful, an error string otherwise
+     */
+    auto convertArchiveEncryption(const std::filesystem::path& source, const std::filesystem::path& target)
+        -> std::expected<ArchiveEncryption, std::string>;
 
 } // namespace mvgltools::mdb1
 
@@ -190,6 +694,16 @@ namespace mvgltools::mdb1::detail
 
             return std::format("{}.{}", trim(nameView), trim(extensionView));
         }
+
+        /**
+         * Get the name as used by the file tree, i.e. as created by buildMDB1Path.
+         */
+        [[nodiscard]] auto toMDB1Path() const -> std::string
+        {
+            std::string path(extension.data(), extension.size());
+            path.append(name.data(), name.size());
+            return path.substr(0, path.find('\0'));
+        }
     };
 
     constexpr auto MDB1_CRYPTED_MAGIC_VALUE = 0x608D920C;
@@ -198,14 +712,27 @@ namespace mvgltools::mdb1::detail
     const std::array<uint8_t, 991> CRYPT_KEY_2 = { 0x92, 0x85, 0x1D, 0xD4, 0x60, 0x7B, 0x1B, 0x3B, 0xDB, 0xFA, 0xCE, 0x92, 0x85, 0x1D, 0xD5, 0x2D, 0xA4, 0xF0, 0xCB, 0x2A, 0x3D, 0x74, 0x80, 0x1B, 0x3B, 0xDB, 0xFA, 0xCD, 0xC5, 0x5C, 0x47, 0x77, 0xE7, 0x97, 0x87, 0xB6, 0x5A, 0xAD, 0x24, 0x6F, 0x7E, 0x82, 0xB6, 0x5A, 0xAD, 0x25, 0x3D, 0x75, 0x4C, 0x78, 0xB4, 0xC0, 0x5B, 0x7B, 0x1A, 0x6D, 0xE4, 0x2F, 0x3E, 0x42, 0x76, 0x1A, 0x6D, 0xE4, 0x30, 0x0C, 0x37, 0xA7, 0x57, 0x47, 0x76, 0x1A, 0x6E, 0xB1, 0x59, 0xE1, 0xC9, 0x91, 0xB9, 0xC1, 0x28, 0xA3, 0x22, 0xD5, 0x2C, 0xD7, 0xC7, 0xF6, 0x99, 0x21, 0x08, 0x03, 0x02, 0x35, 0x0C, 0x38, 0x73, 0xB3, 0xF2, 0x66, 0x49, 0x10, 0x6C, 0x17, 0x06, 0x6A, 0x7E, 0x82, 0xB5, 0x8C, 0xB8, 0xF4, 0x00, 0x9C, 0x87, 0xB6, 0x59, 0xE1, 0xC9, 0x90, 0xEC, 0x97, 0x87, 0xB7, 0x26, 0x0A, 0x9E, 0x21, 0x09, 0xD1, 0xF9, 0x01, 0x68, 0xE4, 0x2F, 0x3F, 0x0F, 0x9F, 0xEF, 0xFF, 0xCE, 0x92, 0x86, 0xE9, 0x31, 0xD8, 0x94, 0x20, 0x3B, 0xDB, 0xFA, 0xCE, 0x92, 0x85, 0x1C, 0x08, 0x03, 0x02, 0x36, 0xD9, 0x60, 0x7C, 0xE8, 0x63, 0xE3, 0x62, 0x15, 0x6D, 0xE5, 0xFD, 0x34, 0x3F, 0x0F, 0x9F, 0xEF, 0xFE, 0x02, 0x36, 0xDA, 0x2D, 0xA4, 0xEF, 0xFE, 0x01, 0x69, 0xB1, 0x59, 0xE0, 0xFB, 0x9B, 0xBA, 0x8D, 0x85, 0x1D, 0xD4, 0x60, 0x7B, 0x1B, 0x3B, 0xDB, 0xFB, 0x9A, 0xEE, 0x32, 0xA5, 0xBC, 0x28, 0xA3, 0x23, 0xA3, 0x23, 0xA3, 0x23, 0xA3, 0x22, 0xD6, 0xFA, 0xCE, 0x92, 0x86, 0xE9, 0x30, 0x0C, 0x38, 0x74, 0x7F, 0x4F, 0xDF, 0x2F, 0x3E, 0x41, 0xA8, 0x23, 0xA3, 0x23, 0xA3, 0x22, 0xD5, 0x2D, 0xA4, 0xF0, 0xCC, 0xF7, 0x67, 0x16, 0x39, 0x40, 0xDB, 0xFB, 0x9B, 0xBA, 0x8D, 0x84, 0x4F, 0xDE, 0x62, 0x16, 0x39, 0x40, 0xDC, 0xC7, 0xF6, 0x99, 0x21, 0x08, 0x04, 0xD0, 0x2C, 0xD8, 0x94, 0x1F, 0x6F, 0x7E, 0x82, 0xB5, 0x8D, 0x85, 0x1C, 0x08, 0x04, 0xD0, 0x2C, 0xD8, 0x93, 0x53, 0x12, 0x05, 0x9C, 0x88, 0x84, 0x4F, 0xDE, 0x61, 0x48, 0x44, 0x0F, 0x9E, 0x22, 0xD5, 0x2D, 0xA5, 0xBC, 0x28, 0xA4, 0xF0, 0xCB, 0x2B, 0x0A, 0x9D, 0x55, 0xAC, 0x58, 0x14, 0xA0, 0xBC, 0x28, 0xA3, 0x22, 0xD6, 0xF9, 0x00, 0x9B, 0xBA, 0x8E, 0x52, 0x45, 0xDC, 0xC7, 0xF7, 0x67, 0x17, 0x06, 0x69, 0xB1, 0x58, 0x13, 0xD2, 0xC6, 0x29, 0x71, 0x18, 0xD4, 0x5F, 0xAE, 0xF1, 0x98, 0x54, 0xE0, 0xFC, 0x68, 0xE4, 0x2F, 0x3F, 0x0E, 0xD1, 0xF9, 0x01, 0x69, 0xB1, 0x58, 0x14, 0x9F, 0xEE, 0x32, 0xA5, 0xBD, 0xF4, 0xFF, 0xCE, 0x91, 0xB9, 0xC0, 0x5B, 0x7B, 0x1B, 0x3A, 0x0D, 0x05, 0x9C, 0x87, 0xB6, 0x5A, 0xAE, 0xF2, 0x65, 0x7C, 0xE8, 0x63, 0xE3, 0x62, 0x15, 0x6C, 0x17, 0x07, 0x36, 0xD9, 0x61, 0x48, 0x43, 0x43, 0x42, 0x75, 0x4C, 0x78, 0xB3, 0xF3, 0x33, 0x72, 0xE6, 0xCA, 0x5E, 0xE1, 0xC8, 0xC3, 0xC3, 0xC3, 0xC2, 0xF6, 0x99, 0x21, 0x08, 0x04, 0xD0, 0x2C, 0xD8, 0x94, 0x1F, 0x6E, 0xB2, 0x26, 0x0A, 0x9E, 0x22, 0xD5, 0x2D, 0xA4, 0xEF, 0xFF, 0xCF, 0x5F, 0xAF, 0xBE, 0xC2, 0xF5, 0xCC, 0xF7, 0x66, 0x4A, 0xDE, 0x61, 0x49, 0x11, 0x39, 0x41, 0xA8, 0x24, 0x70, 0x4C, 0x77, 0xE7, 0x97, 0x86, 0xEA, 0xFD, 0x34, 0x40, 0xDB, 0xFA, 0xCE, 0x92, 0x86, 0xE9, 0x31, 0xD8, 0x93, 0x52, 0x46, 0xAA, 0xBD, 0xF5, 0xCD, 0xC5, 0x5D, 0x14, 0xA0, 0xBB, 0x5A, 0xAE, 0xF2, 0x65, 0x7C, 0xE7, 0x97, 0x86, 0xEA, 0xFD, 0x34, 0x3F, 0x0E, 0xD2, 0xC5, 0x5D, 0x15, 0x6D, 0xE5, 0xFD, 0x35, 0x0C, 0x37, 0xA7, 0x57, 0x47, 0x77, 0xE7, 0x97, 0x87, 0xB6, 0x59, 0xE1, 0xC8, 0xC4, 0x8F, 0x1E, 0xA2, 0x55, 0xAD, 0x24, 0x70, 0x4C, 0x77, 0xE7, 0x96, 0xB9, 0xC0, 0x5C, 0x47, 0x76, 0x1A, 0x6D, 0xE4, 0x2F, 0x3E, 0x41, 0xA9, 0xF1, 0x98, 0x53, 0x12, 0x06, 0x69, 0xB0, 0x8C, 0xB7, 0x26, 0x0A, 0x9D, 0x54, 0xDF, 0x2E, 0x72, 0xE5, 0xFD, 0x34, 0x3F, 0x0F, 0x9F, 0xEE, 0x32, 0xA5, 0xBD, 0xF4, 0xFF, 0xCF, 0x5E, 0xE1, 0xC9, 0x91, 0xB9, 0xC0, 0x5C, 0x48, 0x43, 0x42, 0x75, 0x4C, 0x78, 0xB3, 0xF2, 0x65, 0x7C, 0xE7, 0x96, 0xB9, 0xC1, 0x28, 0xA3, 0x22, 0xD5, 0x2D, 0xA5, 0xBC, 0x27, 0xD6, 0xF9, 0x01, 0x69, 0xB1, 0x58, 0x13, 0xD2, 0xC6, 0x2A, 0x3D, 0x75, 0x4D, 0x45, 0xDC, 0xC7, 0xF6, 0x99, 0x21, 0x09, 0xD0, 0x2C, 0xD7, 0xC7, 0xF7, 0x67, 0x16, 0x39, 0x41, 0xA8, 0x24, 0x6F, 0x7E, 0x82, 0xB6, 0x59, 0xE1, 0xC9, 0x90, 0xEC, 0x98, 0x53, 0x12, 0x05, 0x9C, 0x87, 0xB6, 0x5A, 0xAD, 0x25, 0x3C, 0xA8, 0x24, 0x70, 0x4C, 0x77, 0xE6, 0xCA, 0x5E, 0xE2, 0x95, 0xED, 0x64, 0xB0, 0x8B, 0xEB, 0xCB, 0x2B, 0x0A, 0x9D, 0x55, 0xAC, 0x58, 0x13, 0xD3, 0x92, 0x86, 0xEA, 0xFD, 0x34, 0x3F, 0x0E, 0xD1, 0xF8, 0x34, 0x40, 0xDC, 0xC8, 0xC4, 0x8F, 0x1E, 0xA1, 0x89, 0x50, 0xAB, 0x8A, 0x1D, 0xD5, 0x2D, 0xA4, 0xF0, 0xCB, 0x2B, 0x0A, 0x9D, 0x55, 0xAC, 0x57, 0x46, 0xA9, 0xF0, 0xCC, 0xF7, 0x67, 0x17, 0x07, 0x36, 0xDA, 0x2E, 0x71, 0x19, 0xA1, 0x88, 0x83, 0x83, 0x83, 0x82, 0xB6, 0x5A, 0xAD, 0x25, 0x3D, 0x74, 0x80, 0x1C, 0x08, 0x04, 0xCF, 0x5F, 0xAF, 0xBF, 0x8E, 0x51, 0x78, 0xB3, 0xF3, 0x32, 0xA5, 0xBD, 0xF5, 0xCD, 0xC4, 0x90, 0xEC, 0x97, 0x87, 0xB7, 0x27, 0xD7, 0xC6, 0x29, 0x70, 0x4B, 0xAB, 0x8B, 0xEB, 0xCB, 0x2A, 0x3D, 0x74, 0x7F, 0x4F, 0xDE, 0x62, 0x15, 0x6D, 0xE5, 0xFD, 0x34, 0x40, 0xDB, 0xFA, 0xCD, 0xC4, 0x90, 0xEB, 0xCA, 0x5E, 0xE1, 0xC9, 0x91, 0xB9, 0xC1, 0x28, 0xA4, 0xEF, 0xFF, 0xCE, 0x92, 0x85, 0x1D, 0xD4, 0x5F, 0xAE, 0xF2, 0x65, 0x7D, 0xB5, 0x8D, 0x84, 0x50, 0xAC, 0x57, 0x47, 0x76, 0x1A, 0x6E, 0xB1, 0x59, 0xE0, 0xFB, 0x9B, 0xBB, 0x5B, 0x7A, 0x4D, 0x45, 0xDD, 0x95, 0xED, 0x65, 0x7D, 0xB4, 0xBF, 0x8F, 0x1F, 0x6F, 0x7E, 0x81, 0xE9, 0x30, 0x0C, 0x37, 0xA6, 0x89, 0x50, 0xAC, 0x57, 0x46, 0xAA, 0xBD, 0xF5, 0xCC, 0xF7, 0x66, 0x4A, 0xDE, 0x61, 0x48, 0x44, 0x10, 0x6C, 0x18, 0xD4, 0x5F, 0xAF, 0xBE, 0xC1, 0x28, 0xA3, 0x23, 0xA2, 0x55, 0xAC, 0x58, 0x14, 0xA0, 0xBC, 0x28, 0xA4, 0xEF, 0xFF, 0xCF, 0x5E, 0xE1, 0xC8, 0xC4, 0x8F, 0x1E, 0xA1, 0x88, 0x83, 0x82, 0xB5, 0x8C, 0xB7, 0x27, 0xD6, 0xF9, 0x00, 0x9C, 0x87, 0xB6, 0x59, 0xE1, 0xC9, 0x90, 0xEC, 0x98, 0x53, 0x13, 0xD3, 0x93, 0x53, 0x12, 0x06, 0x6A, 0x7D, 0xB5, 0x8C, 0xB8, 0xF4, 0xFF, 0xCF, 0x5F, 0xAF, 0xBE, 0xC2, 0xF5, 0xCD, 0xC4, 0x8F, 0x1F, 0x6E, 0xB1, 0x59, 0xE1, 0xC8, 0xC4, 0x90, 0xEB, 0xCA, 0x5E, 0xE2, 0x95, 0xED, 0x64, 0xAF, 0xBE, 0xC1, 0x28, 0xA3, 0x23, 0xA3, 0x23, 0xA3, 0x23, 0xA2, 0x55, 0xAD, 0x25, 0x3D, 0x74, 0x7F, 0x4F, 0xDE, 0x62, 0x16, 0x39, 0x40, 0xDC, 0xC7, 0xF7, 0x67, 0x17, 0x06, 0x69, 0xB1, 0x58, 0x13, 0xD3, 0x93, 0x53, 0x13, 0xD2, 0xC5, 0x5C, 0x47, 0x77 };
     // clang-format on
 
-    constexpr void cryptArray(char* array, std::size_t size, uint64_t offset)
+    /**
+     * Get both keys combined into a single keystream, which repeats after 997 * 991 bytes. It's computed on first use.
+     */
+    auto getCryptKeystream() -> std::span<const uint8_t>;
+
+    inline void cryptArray(char* array, std::size_t size, uint64_t offset)
     {
-        for (size_t i = 0; i < size; i++)
-            array[i] ^= CRYPT_KEY_1[(offset + i) % 997] ^ CRYPT_KEY_2[(offset + i) % 991]; // NOLINT
+        const auto keystream = getCryptKeystream();
+        auto position        = static_cast<size_t>(offset % keystream.size());
+
+        for (size_t i = 0; i < size; position = 0)
+        {
+            const auto count = std::min(size - i, keystream.size() - position);
+            for (size_t j = 0; j < count; j++)
+                array[i + j] ^= static_cast<char>(keystream[position + j]); // NOLINT
+            i += count;
+        }
     }
 
     template<std::size_t SIZE>
-    constexpr void cryptArray(std::array<char, SIZE>& array, uint64_t offset)
+    void cryptArray(std::array<char, SIZE>& array, uint64_t offset)
     {
         cryptArray(array.data(), array.size(), offset);
     }
@@ -245,10 +772,154 @@ namespace mvgltools::mdb1::detail
         }
     };
 
+    template<typename MDB>
+    constexpr auto IS_ENCRYPTED = std::same_as<typename MDB::InputStream, dscs_ifstream>;
+
+    // how far ahead of the current read position the OS is asked to read ahead, when extracting
+    constexpr uint64_t READAHEAD_SIZE = 64ULL * 1024 * 1024;
+
+    // stored data smaller than this is read and written through io_uring, if available, instead of being copied
+    constexpr uint64_t MIN_ASYNC_COPY_SIZE = 1024ULL * 1024;
+
+    // how much read data may wait for being decompressed, when extracting
+    constexpr uint64_t MAX_PENDING_SIZE = 256ULL * 1024 * 1024;
+
+    template<typename MDB>
+    constexpr auto INVALID_DATA_ID = std::numeric_limits<decltype(MDB::TreeEntry::dataId)>::max();
+
+    constexpr uint32_t PATCH_MAGIC_VALUE = 0x5450564d; // MVPT
+    constexpr uint32_t PATCH_VERSION     = 3;
+
+    struct PatchHeader
+    {
+        uint32_t magicValue{PATCH_MAGIC_VALUE};
+        uint32_t version{PATCH_VERSION};
+        uint64_t entryCount{};
+        /**
+         * Identify the base archive, by its file size and the CRC-64 of its header and tables.
+         */
+        uint64_t baseSize{};
+        uint64_t baseChecksum{};
+        /**
+         * The number of PatchDependency entries following the patch entries.
+         */
+        uint64_t dependencyCount{};
+    };
+
+    /**
+     * The stored data of a base file the patch keeps as it is, identified by the CRC-64 of the data.
+     */
+    struct PatchDependency
+    {
+        uint64_t dataId;
+        uint64_t checksum;
+    };
+
+    /**
+     * Each patch entry is the type, the name size and name, followed by the full size, the stored size and the stored
+     * data for added and replaced files.
+     */
+    enum class PatchEntryType : uint8_t
+    {
+        ADDED,
+        REMOVED,
+        REPLACED,
+    };
+
+    template<typename MDB>
+    struct ArchiveTables
+    {
+        typename MDB::Header header;
+        std::vector<typename MDB::TreeEntry> treeEntries;
+        std::vector<typename MDB::NameEntry> nameEntries;
+        std::vector<typename MDB::DataEntry> dataEntries;
+    };
+
+    template<typename MDB>
+    auto readTables(typename MDB::InputStream& input) -> ArchiveTables<MDB>
+    {
+        ArchiveTables<MDB> tables{.header = read<typename MDB::Header>(input)};
+        const auto& header = tables.header;
+        // don't trust the counts of anything that isn't an archive
+        if (header.magicValue != MDB1_MAGIC_VALUE) return tables;
+
+        for (int32_t i = 0; i < header.fileEntryCount && input; i++)
+            tables.treeEntries.push_back(read<typename MDB::TreeEntry>(input));
+        for (int32_t i = 0; i < header.fileNameCount && input; i++)
+            tables.nameEntries.push_back(read<typename MDB::NameEntry>(input));
+        for (int32_t i = 0; i < header.dataEntryCount && input; i++)
+            tables.dataEntries.push_back(read<typename MDB::DataEntry>(input));
+
+        return tables;
+    }
+
+    /**
+     * Calculate the CRC-64 of everything in front of the data of an archive, i.e. its header and file tables.
+     */
+    template<typename MDB>
+    auto getTableChecksum(const std::filesystem::path& archive) -> std::expected<uint64_t, std::string>
+    {
+        typename MDB::InputStream input(archive, std::ios::in | std::ios::binary);
+        auto header = read<typename MDB::Header>(input);
+
+        std::error_code error;
+        auto fileSize = std::filesystem::file_size(archive, error);
+        if (!input || error || header.dataStart > fileSize)
+            return std::unexpected(std::format("Error: failed to read {}.", archive.string()));
+
+        std::vector<char> tables(header.dataStart);
+        input.seekg(0);
+        input.read(tables.data(), static_cast<std::streamsize>(tables.size()));
+        if (!input) return std::unexpected(std::format("Error: failed to read {}.", archive.string()));
+
+        return getChecksum64(tables);
+    }
+
+    /**
+     * Write the tables of an archive, the header last. If the path of the archive is given, everything written so far
+     * is synced to the disk before the tables and again before the header, so an archive updated in place never gets
+     * a header for tables or data that didn't make it to the disk.
+     */
+    template<typename MDB>
+    void writeTables(typename MDB::OutputStream& output,
+                     ArchiveTables<MDB>& tables,
+                     const std::filesystem::path& syncPath = {})
+    {
+        using Header = typename MDB::Header;
+
+        auto sync = [&output, &syncPath]
+        {
+            output.flush();
+            if (!syncPath.empty()) syncFile(syncPath);
+        };
+
+        // the tables go out in a single write and the header last, to keep the time an archive updated in place is
+        // inconsistent as short as possible
+        sync();
+        std::vector<char> buffer;
+        auto append = [&buffer]<typename T>(const std::vector<T>& entries)
+        {
+            const auto* data = reinterpret_cast<const char*>(entries.data());
+            buffer.insert(buffer.end(), data, data + (entries.size() * sizeof(T)));
+        };
+        append(tables.treeEntries);
+        append(tables.nameEntries);
+        append(tables.dataEntries);
+
+        output.seekp(sizeof(Header));
+        output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        sync();
+
+        auto header = tables.header;
+        output.seekp(0);
+        output.write(reinterpret_cast<char*>(&header), sizeof(Header));
+        sync();
+    }
+
     struct TreeName
     {
         std::string name;
-        std::filesystem::path path;
+        size_t index{};
 
         friend auto operator==(const TreeName& self, const TreeName& other) -> bool { return self.name == other.name; }
     };
@@ -270,26 +941,82 @@ namespace mvgltools::mdb1::detail
 
     constexpr uint64_t INVALID = std::numeric_limits<uint64_t>::max();
 
-    auto generateTree(const std::vector<std::filesystem::path>& paths, const std::filesystem::path& source)
-        -> std::vector<TreeNode>;
+    auto generateTree(const std::vector<TreeName>& fileNames) -> std::vector<TreeNode>;
 
-    template<Compressor Compress>
-    auto getFileData(const std::filesystem::path& file, CompressMode mode)
-        -> std::expected<CompressionResult, std::string>
+    auto buildMDB1Path(const std::filesystem::path& path) -> std::string;
+
+    auto readFileData(const std::filesystem::path& file) -> std::expected<std::vector<char>, std::string>;
+
+    /**
+     * Represents a file in an extraction manifest, identifying its stored data and the file it was extracted to.
+     */
+    struct ManifestEntry
+    {
+        uint64_t checksum;
+        uint64_t fullSize;
+        /**
+         * The last write time of the extracted file, to notice when it got changed afterwards.
+         */
+        int64_t writeTime;
+
+        friend auto operator==(const ManifestEntry& self, const ManifestEntry& other) -> bool = default;
+    };
+
+    using Manifest = std::map<std::string, ManifestEntry>;
+
+    constexpr std::string_view MANIFEST_HEADER = "MVGLTools manifest v2";
+
+    /**
+     * Get the last write time of a file as stored in a manifest, 0 if it doesn't exist.
+     */
+    inline auto getWriteTime(const std::filesystem::path& path) -> int64_t
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    /**
+     * Read an extraction manifest. If the file doesn't exist or is invalid, the manifest is empty.
+     */
+    auto readManifest(const std::filesystem::path& path) -> Manifest;
+
+    /**
+     * Write an extraction manifest, replacing the existing one.
+     */
+    auto writeManifest(const std::filesystem::path& path, const Manifest& manifest) -> std::expected<void, std::string>;
+
+    /**
+     * Make sure a new file can be written to the given path, creating its parent directories. An existing file gets
+     * removed, it might be a hardlink from extracting duplicates before and writing into it would change all of them.
+     */
+    inline auto prepareOutputFile(const std::filesystem::path& output) -> std::expected<void, std::string>
     {
-        std::ifstream input(file, std::ios::in | std::ios::binary);
+        if (std::filesystem::exists(output) && !std::filesystem::is_regular_file(output))
+            return std::unexpected("Output path already exists and isn't a file.");
+        if (output.has_parent_path()) std::filesystem::create_directories(output.parent_path());
 
-        if (!input.good())
-            return std::unexpected(std::format("Error: something went wrong while decompressing {}", file.string()));
+        std::error_code error;
+        std::filesystem::remove(output, error);
+        if (error)
+            return std::unexpected(std::format("Error: failed to replace {}: {}", output.string(), error.message()));
+
+        return {};
+    }
 
-        auto size = std::filesystem::file_size(file);
-        std::vector<char> data(size);
-        input.read(data.data(), static_cast<std::streamsize>(data.size()));
+    /**
+     * Create target as a copy of the source file, in the way given by the mode. An existing target gets replaced.
+     */
+    auto duplicateFile(const std::filesystem::path& source, const std::filesystem::path& target, DuplicateMode mode)
+        -> std::expected<void, std::string>;
 
+    template<Compressor Compress>
+    auto compressData(std::vector<char> data, CompressMode mode) -> CompressionResult
+    {
         auto checksum = mode == CompressMode::ADVANCED ? getChecksum(data) : 0;
 
-        if (size == 0 || Compress::isCompressed(data) || mode == CompressMode::NONE)
-            return CompressionResult{.originalSize = data.size(), .crc = checksum, .data = data};
+        if (data.empty() || Compress::isCompressed(data) || mode == CompressMode::NONE)
+            return CompressionResult{.originalSize = data.size(), .crc = checksum, .data = std::move(data)};
 
         auto compressed = Compress::compress(data).value_or(data);
 
@@ -298,9 +1025,107 @@ namespace mvgltools::mdb1::detail
         return CompressionResult{
             .originalSize = data.size(),
             .crc          = checksum,
-            .data         = compressed,
+            .data         = std::move(compressed),
         };
     }
+
+    template<Compressor Compress>
+    auto getFileData(const ArchiveFile& file, CompressMode mode) -> std::expected<CompressionResult, std::string>
+    {
+        try
+        {
+            if (file.loadRaw)
+            {
+                auto raw = file.loadRaw();
+                if (!raw) return std::unexpected(raw.error());
+
+                auto checksum = mode == CompressMode::ADVANCED ? getChecksum(raw->data) : 0;
+                return CompressionResult{.originalSize = raw->fullSize, .crc = checksum, .data = std::move(raw->data)};
+            }
+
+            auto data = file.load();
+            if (!data) return std::unexpected(data.error());
+
+            return compressData<Compress>(std::move(data.value()), mode);
+        }
+        catch (std::exception& ex)
+        {
+            return std::unexpected(std::format("Error: failed to load {}: {}", file.path.string(), ex.what()));
+        }
+    }
+
+    /**
+     * Get the size of a file that gets copied into the archive as is, without loading it.
+     */
+    inline auto getSourceSize(const ArchiveFile& file) -> std::expected<CompressionResult, std::string>
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(file.source, error);
+        if (error)
+            return std::unexpected(std::format("Error: failed to load {}: {}", file.path.string(), error.message()));
+
+        return CompressionResult{.originalSize = size, .crc = 0, .data = {}};
+    }
+
+    /**
+     * Start compressing the given files on the pool, in the given order. The returned futures are indexed like files.
+     */
+    template<Compressor Compress>
+    auto compressFiles(boost::asio::thread_pool& pool,
+                       const std::vector<ArchiveFile>& files,
+                       const std::vector<size_t>& order,
+                       CompressMode mode) -> std::vector<std::future<std::expected<CompressionResult, std::string>>>
+    {
+        using Result = std::expected<CompressionResult, std::string>;
+
+        std::vector<std::future<Result>> futures(files.size());
+        for (auto index : order)
+        {
+            // not posted directly, asio treats packaged_tasks as completion tokens
+            auto task = std::make_shared<std::packaged_task<Result()>>(
+                [&files, index, mode] { return getFileData<Compress>(files[index], mode); });
+            futures[index] = task->get_future();
+            boost::asio::post(pool, [task] { (*task)(); });
+        }
+
+        return futures;
+    }
+
+    template<typename MDB>
+    auto getTableSize(size_t fileCount, size_t dataCount) -> uint64_t
+    {
+        return sizeof(typename MDB::Header) + (sizeof(typename MDB::TreeEntry) * (fileCount + 1)) +
+               (sizeof(typename MDB::NameEntry) * (fileCount + 1)) + (sizeof(typename MDB::DataEntry) * dataCount);
+    }
+
+    /**
+     * Look up a name in the file tree the way the game does, starting at the right child of the root node and
+     * following the compare bits until a node points back up the tree.
+     *
+     * @return the index of the tree entry the lookup ends at, or INVALID if it leaves the tree
+     */
+    template<typename MDB>
+    auto findTreeEntry(const std::vector<typename MDB::TreeEntry>& treeEntries, std::string_view name) -> uint64_t
+    {
+        constexpr auto ROOT_BIT = std::numeric_limits<decltype(MDB::TreeEntry::compareBit)>::max();
+        auto isBitSet           = [name](uint64_t pos)
+        { return (pos >> 3) < name.size() && ((name[pos >> 3] >> (pos & 7)) & 1) != 0; };
+
+        if (treeEntries.empty()) return INVALID;
+
+        int64_t previousBit = -1;
+        uint64_t index      = treeEntries[0].right;
+        for (size_t i = 0; i < treeEntries.size() && index < treeEntries.size(); i++)
+        {
+            const auto& entry = treeEntries[index];
+            if (entry.compareBit == ROOT_BIT || static_cast<int64_t>(entry.compareBit) <= previousBit) return index;
+
+            previousBit = entry.compareBit;
+            index       = isBitSet(entry.compareBit) ? entry.right : entry.left;
+        }
+
+        return INVALID;
+    }
 } // namespace mvgltools::mdb1::detail
 
 // implementation
@@ -386,205 +1211,1502 @@ namespace mvgltools::mdb1
 
     template<ArchiveType MDB>
     ArchiveInfo<MDB>::ArchiveInfo(const std::filesystem::path& path)
-        : input(path, std::ios::in | std::ios::binary)
+        : path(path)
+        , input(path, std::ios::in | std::ios::binary)
     {
         if (!input) return;
 
-        auto header = read<typename MDB::Header>(input);
+        auto [header, treeEntries, nameEntries, dataEntries] = readTables<MDB>(input);
 
         dataStart = header.dataStart;
 
-        assert(header.fileEntryCount == header.fileNameCount);
-
-        std::vector<typename MDB::TreeEntry> treeEntries;
-        std::vector<typename MDB::NameEntry> nameEntries;
-        std::vector<typename MDB::DataEntry> dataEntries;
-        for (int32_t i = 0; i < header.fileEntryCount; i++)
-            treeEntries.push_back(read<typename MDB::TreeEntry>(input));
-        for (int32_t i = 0; i < header.fileNameCount; i++)
-            nameEntries.push_back(read<typename MDB::NameEntry>(input));
-        for (int32_t i = 0; i < header.dataEntryCount; i++)
-            dataEntries.push_back(read<typename MDB::DataEntry>(input));
+        if (!input || header.magicValue != MDB1_MAGIC_VALUE || header.fileEntryCount != header.fileNameCount) return;
 
         for (int32_t i = 0; i < treeEntries.size(); i++)
         {
             auto dataId = treeEntries[i].dataId;
-            if (dataId == std::numeric_limits<decltype(dataId)>::max()) continue;
+            if (dataId == INVALID_DATA_ID<MDB> || dataId >= dataEntries.size()) continue;
             auto data = dataEntries.at(dataId);
 
             entries[nameEntries[i].toString()] = {
                 .offset         = data.offset,
                 .fullSize       = data.fullSize,
                 .compressedSize = data.compressedSize,
+                .dataId         = dataId,
             };
         }
+
+        valid = true;
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::isValid() const -> bool
+    {
+        return valid;
     }
 
     template<ArchiveType MDB>
-    auto ArchiveInfo<MDB>::extract(const std::filesystem::path& output) -> std::expected<void, std::string>
+    auto ArchiveInfo<MDB>::extract(const std::filesystem::path& output, const ExtractOptions& options)
+        -> std::expected<void, std::string>
     {
+        const auto& [filter, jobs, duplicates, manifestPath] = options;
         if (std::filesystem::exists(output) && !std::filesystem::is_directory(output))
             return std::unexpected("Output path is not a directory.");
         if (output.has_parent_path()) std::filesystem::create_directories(output.parent_path());
 
-        auto extract_fn = [this, output](const auto& key)
+        const auto useManifest = !manifestPath.empty();
+        auto manifest          = useManifest ? readManifest(manifestPath) : Manifest{};
+
+        // the files are read in the order their data is stored in, decompressing and writing happens on the pool, in
+        // any order
+        auto selected = selectEntries(filter);
+        auto getPath = [&output](std::string file)
         {
-            auto file = key.first;
-            std::replace(file.begin(), file.end(), '\\', '/');
-            std::filesystem::path path = output / file;
+            std::ranges::replace(file, '\\', '/');
+            return output / file;
+        };
 
-            return extractFile(path, key.second);
+        // a group of files is pending from reading its data until all its files are written
+        std::mutex pendingMutex;
+        std::condition_variable pendingCondition;
+        uint64_t pendingSize = 0;
+        size_t pendingGroups = 0;
+        uint64_t hintedEnd   = 0;
+        ReadaheadHint readahead(path);
+        auto finishGroup = [&](uint64_t size)
+        {
+            const std::lock_guard lock(pendingMutex);
+            pendingSize -= size;
+            pendingGroups--;
+            pendingCondition.notify_one();
         };
-        auto has_value_fn = [](const auto& value) { return !value.has_value(); };
 
-        auto result = entries | std::views::transform(extract_fn) | std::views::filter(has_value_fn) |
-                      std::ranges::to<std::vector<std::expected<void, std::string>>>();
-        if (!result.empty()) return result[0];
+        std::vector<std::expected<void, std::string>> results(selected.size());
+        std::vector<uint64_t> checksums(selected.size());
+        boost::asio::thread_pool pool(jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : jobs);
+        // with io_uring the data is read and the files are written asynchronously, the pool only decompresses
+        auto asyncIO = AsyncIO::create(path);
 
-        return {};
-    }
+        auto processGroup = [&](size_t begin, size_t end, uint64_t readSize, bool copyStored, std::vector<char> data)
+        {
+            std::vector<size_t> pending;
+            auto writeDuplicates = [&, readSize](std::vector<size_t> files, std::expected<void, std::string> result)
+            {
+                try
+                {
+                    const auto first  = getPath(selected[files[0]].first);
+                    results[files[0]] = result;
+                    for (auto i : files | std::views::drop(1))
+                        results[i] = result ? duplicateFile(first, getPath(selected[i].first), duplicates) : result;
+                }
+                catch (std::exception& ex)
+                {
+                    for (auto i : files)
+                        results[i] = std::unexpected(ex.what());
+                }
+
+                finishGroup(readSize);
+            };
 
-    template<ArchiveType MDB>
-    auto ArchiveInfo<MDB>::extractSingleFile(const std::filesystem::path& output, std::string file)
-        -> std::expected<void, std::string>
-    {
-        std::ranges::replace(file, '/', '\\');
-        if (!entries.contains(file))
-            return std::unexpected(std::format("File '{}' does not exist in the archive.", file));
+            std::expected<void, std::string> result;
+            try
+            {
+                const auto fullSize = selected[begin].second.fullSize;
+                const auto checksum = useManifest ? getChecksum64(data) : 0;
+                // the file on disk must still be the one written, with the same size and write time
+                auto isUnchanged = [&](size_t index)
+                {
+                    std::error_code error;
+                    auto old  = manifest.find(selected[index].first);
+                    auto path = getPath(selected[index].first);
+                    return old != manifest.end() && old->second.checksum == checksum &&
+                           old->second.fullSize == fullSize && std::filesystem::file_size(path, error) == fullSize &&
+                           old->second.writeTime == getWriteTime(path);
+                };
+
+                // files that didn't change since the manifest was written are skipped
+                for (auto i = begin; i < end; i++)
+                {
+                    checksums[i] = checksum;
+                    if (!useManifest || !isUnchanged(i)) pending.push_back(i);
+                }
+                if (pending.empty()) return finishGroup(readSize);
+
+                const auto first = getPath(selected[pending[0]].first);
+                if (copyStored) return writeDuplicates(pending, copyStoredFile(first, selected[begin].second));
+
+                if (data.size() != fullSize)
+                {
+                    auto decompressed = MDB::Compressor::decompress(data, fullSize);
+                    if (!decompressed) return writeDuplicates(pending, std::unexpected(decompressed.error()));
+                    data = std::move(decompressed.value());
+                }
+                if (!asyncIO) return writeDuplicates(pending, writeFile(first, data));
+
+                result = prepareOutputFile(first);
+                if (result)
+                {
+                    if constexpr (IS_ENCRYPTED<MDB>) cryptArray(data.data(), data.size(), 0);
+                    // the callback runs on the I/O thread, copying the duplicates is left to the pool
+                    asyncIO->writeFile(first,
+                                       std::move(data),
+                                       [&pool, writeDuplicates, pending](std::expected<void, std::string> written)
+                                       {
+                                           boost::asio::post(pool,
+                                                             [writeDuplicates, pending, written]
+                                                             { writeDuplicates(pending, written); });
+                                       });
+                    return;
+                }
+            }
+            catch (std::exception& ex)
+            {
+                result = std::unexpected(ex.what());
+                pending.clear();
+                for (auto i = begin; i < end; i++)
+                    pending.push_back(i);
+            }
 
-        return extractFile(output, entries.at(file));
-    }
+            writeDuplicates(pending, result);
+        };
 
-    template<ArchiveType MDB>
-    auto ArchiveInfo<MDB>::extractFile(const std::filesystem::path& output, const ArchiveEntry& entry)
-        -> std::expected<void, std::string>
-    {
-        std::vector<char> inputData(entry.compressedSize);
+        for (size_t begin = 0, end = 0; begin < selected.size(); begin = end)
+        {
+            // files sharing their data are next to each other now, the data only needs to be extracted once
+            const auto& entry = selected[begin].second;
+            for (end = begin + 1; end < selected.size() && selected[end].second == entry; end++)
+                ;
 
-        input.seekg(dataStart + entry.offset);
-        input.read(inputData.data(), inputData.size());
+            if (entry.offset + entry.compressedSize > hintedEnd)
+            {
+                readahead.willNeed(dataStart + entry.offset, READAHEAD_SIZE);
+                hintedEnd = entry.offset + READAHEAD_SIZE;
+            }
 
-        auto result = MDB::Compressor::decompress(inputData, entry.fullSize);
-        if (!result) return std::unexpected(result.error());
+            // stored data gets copied into the file by the kernel, unless it needs to be encrypted or checksummed.
+            // Small files are written faster through io_uring, without the blocking syscalls of a copy.
+            const auto copyStored = !IS_ENCRYPTED<MDB> && !useManifest && entry.compressedSize == entry.fullSize &&
+                                    (!asyncIO || entry.fullSize >= MIN_ASYNC_COPY_SIZE);
+            const auto readSize   = copyStored ? 0 : entry.compressedSize;
 
-        if (std::filesystem::exists(output) && !std::filesystem::is_regular_file(output))
-            return std::unexpected("Output path already exists and isn't a file.");
-        if (output.has_parent_path()) std::filesystem::create_directories(output.parent_path());
+            // limit the amount of read data waiting for the pool
+            {
+                std::unique_lock lock(pendingMutex);
+                pendingCondition.wait(lock, [&] { return pendingSize < MAX_PENDING_SIZE; });
+                pendingSize += readSize;
+                pendingGroups++;
+            }
+
+            if (asyncIO && !copyStored)
+            {
+                const auto offset = dataStart + entry.offset;
+                auto onRead       = [&, begin, end, readSize, offset](AsyncIO::ReadResult data)
+                {
+                    auto task = [&, begin, end, readSize, offset, data = std::move(data)]() mutable
+                    {
+                        if (!data)
+                        {
+                            for (auto i = begin; i < end; i++)
+                                results[i] = std::unexpected(data.error());
+                            return finishGroup(readSize);
+                        }
+
+                        if constexpr (IS_ENCRYPTED<MDB>) cryptArray(data->data(), data->size(), offset);
+                        processGroup(begin, end, readSize, false, std::move(data.value()));
+                    };
+                    boost::asio::post(pool, std::move(task));
+                };
+                asyncIO->read(offset, entry.compressedSize, std::move(onRead));
+                continue;
+            }
+
+            auto data = copyStored ? AsyncIO::ReadResult() : readRawEntry(entry);
+            auto task = [&, data = std::move(data), begin, end, readSize, copyStored]() mutable
+            {
+                if (!data)
+                {
+                    for (auto i = begin; i < end; i++)
+                        results[i] = std::unexpected(data.error());
+                    return finishGroup(readSize);
+                }
+
+                processGroup(begin, end, readSize, copyStored, std::move(data.value()));
+            };
+            boost::asio::post(pool, std::move(task));
+        }
+
+        // with asynchronous I/O the pool runs out of tasks before the files are written
+        {
+            std::unique_lock lock(pendingMutex);
+            pendingCondition.wait(lock, [&] { return pendingGroups == 0; });
+        }
+        pool.join();
+
+        auto error = std::ranges::find_if(results, [](const auto& value) { return !value.has_value(); });
+        if (useManifest)
+        {
+            // failed files are removed from the manifest, so they're extracted again next time
+            for (size_t i = 0; i < selected.size(); i++)
+            {
+                const auto& [name, entry] = selected[i];
+                if (results[i])
+                    manifest[name] = {
+                        .checksum  = checksums[i],
+                        .fullSize  = entry.fullSize,
+                        .writeTime = getWriteTime(getPath(name)),
+                    };
+                else
+                    manifest.erase(name);
+            }
+
+            auto written = writeManifest(manifestPath, manifest);
+            if (!written && error == results.end()) return written;
+        }
+        if (error != results.end()) return *error;
 
-        typename MDB::OutputStream outputStream(output, std::ios::out | std::ios::binary);
-        outputStream.write(result.value().data(), result.value().size());
         return {};
     }
 
     template<ArchiveType MDB>
-    auto packArchive(const std::filesystem::path& source, const std::filesystem::path& target, CompressMode compress)
+    auto ArchiveInfo<MDB>::extractTar(std::ostream& output, const ExtractOptions& options)
         -> std::expected<void, std::string>
     {
-        if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source))
-            return std::unexpected("Source path does not exist or is not a directory.");
-        if (target.has_parent_path() && !std::filesystem::exists(target))
-            std::filesystem::create_directories(target.parent_path());
-
-        std::vector<std::filesystem::path> files;
+        using Result = std::expected<std::vector<char>, std::string>;
 
-        for (const auto& i : std::filesystem::recursive_directory_iterator(source))
-            if (std::filesystem::is_regular_file(i)) files.push_back(i);
+        const auto& [filter, jobs, duplicates, manifestPath] = options;
+        if (!input.is_open()) return std::unexpected("Error: failed to read the archive.");
+        if (!manifestPath.empty()) return std::unexpected("Error: a manifest can't be used when writing a tar.");
 
-        std::ranges::sort(files);
+        auto selected = selectEntries(filter);
+        auto getName  = [&selected](size_t index)
+        {
+            auto name = selected[index].first;
+            std::ranges::replace(name, '\\', '/');
+            return name;
+        };
 
-        log("[Pack] Generating File Tree...");
-        auto tree = generateTree(files, source);
+        // all entries get the modification time of the archive
+        std::error_code error;
+        const auto modified = std::filesystem::last_write_time(path, error);
+        const auto seconds  = std::chrono::floor<std::chrono::seconds>(std::chrono::file_clock::to_sys(modified));
+        tar::TarWriter writer(output, error ? 0 : seconds.time_since_epoch().count());
 
-        // start compressing files
-        std::map<std::string, std::promise<std::expected<CompressionResult, std::string>>> futureMap;
-        // twice the core count to account for blocking threads
-        auto threadCount = std::thread::hardware_concurrency() * 2;
-        boost::asio::thread_pool pool(threadCount);
-        log(std::format("[Pack] Start compressing files with {} threads...", threadCount));
+        // groups get decompressed on the pool, but are written by this thread in the order they got read in
+        std::deque<std::tuple<size_t, size_t, std::future<Result>>> pending;
+        uint64_t pendingSize = 0;
+        uint64_t hintedEnd   = 0;
+        ReadaheadHint readahead(path);
+        boost::asio::thread_pool pool(jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : jobs);
 
-        for (const auto& file : tree)
+        auto writeGroup = [&]() -> std::expected<void, std::string>
         {
-            if (file.compareBit == std::numeric_limits<decltype(file.compareBit)>::max()) continue;
+            auto [begin, end, future] = std::move(pending.front());
+            pending.pop_front();
+            pendingSize -= selected[begin].second.fullSize;
 
-            futureMap[file.name.name] = std::promise<std::expected<CompressionResult, std::string>>();
+            auto data = future.get();
+            if (!data)
+                return std::unexpected(std::format("Error: failed to extract {}: {}", getName(begin), data.error()));
 
-            auto lambda = [&]
-            { futureMap[file.name.name].set_value(getFileData<typename MDB::Compressor>(file.name.path, compress)); };
+            writer.addFile(getName(begin), data.value());
+            for (auto i = begin + 1; i < end; i++)
+            {
+                if (duplicates == DuplicateMode::HARDLINK)
+                    writer.addHardLink(getName(i), getName(begin));
+                else
+                    writer.addFile(getName(i), data.value());
+            }
 
-            boost::asio::post(pool, lambda);
-        }
+            if (!output) return std::unexpected("Error: failed to write the tar.");
+            return {};
+        };
 
-        std::vector<typename MDB::TreeEntry> treeEntries;
-        std::vector<typename MDB::NameEntry> nameEntries;
-        std::vector<typename MDB::DataEntry> dataEntries;
+        for (size_t begin = 0, end = 0; begin < selected.size(); begin = end)
+        {
+            // files sharing their data are next to each other, the data only needs to be decompressed once
+            const auto& entry = selected[begin].second;
+            for (end = begin + 1; end < selected.size() && selected[end].second == entry; end++)
+                ;
 
-        const auto fileCount     = files.size();
-        const auto headerSize    = sizeof(typename MDB::Header);
-        const auto treeEntrySize = sizeof(typename MDB::TreeEntry) * (fileCount + 1);
-        const auto nameEntrySize = sizeof(typename MDB::NameEntry) * (fileCount + 1);
-        const auto dataEntrySize = sizeof(typename MDB::DataEntry) * (fileCount);
-        const auto dataStart     = headerSize + treeEntrySize + nameEntrySize + dataEntrySize;
+            if (entry.offset + entry.compressedSize > hintedEnd)
+            {
+                readahead.willNeed(dataStart + entry.offset, READAHEAD_SIZE);
+                hintedEnd = entry.offset + READAHEAD_SIZE;
+            }
 
-        treeEntries.push_back({
-            .compareBit = std::numeric_limits<decltype(MDB::TreeEntry::compareBit)>::max(),
-            .dataId     = std::numeric_limits<decltype(MDB::TreeEntry::dataId)>::max(),
-            .left       = 0,
-            .right      = 1,
-        });
-        nameEntries.push_back({});
+            // limit the amount of data waiting for being written, it's held in memory after decompressing it
+            while (pendingSize >= MAX_PENDING_SIZE)
+            {
+                auto result = writeGroup();
+                if (!result) return result;
+            }
 
-        auto fileId = 0;
-        std::map<uint32_t, size_t> dataMap;
-        size_t offset = 0;
-        typename MDB::OutputStream output(target, std::ios::out | std::ios::binary);
+            auto decompress = [fullSize = entry.fullSize, data = readRawEntry(entry)]() mutable -> Result
+            {
+                if (!data) return data;
+                if (data->size() != fullSize)
+                {
+                    auto decompressed = MDB::Compressor::decompress(data.value(), fullSize);
+                    if (!decompressed) return std::unexpected(decompressed.error());
+                    data = std::move(decompressed.value());
+                }
+
+                // match the data written by extract, which applies the asset encryption on write
+                if constexpr (IS_ENCRYPTED<MDB>) cryptArray(data->data(), data->size(), 0);
+                return data;
+            };
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(decompress));
+            pending.emplace_back(begin, end, task->get_future());
+            pendingSize += entry.fullSize;
+            boost::asio::post(pool, [task] { (*task)(); });
+        }
 
-        for (const auto& file : tree)
+        while (!pending.empty())
         {
-            if (file.compareBit == std::numeric_limits<decltype(file.compareBit)>::max()) continue;
-
-            if (fileId++ % 200 == 0) log(std::format("[Pack] Writing File {} of {}", fileId, fileCount));
-
-            auto data = futureMap[file.name.name].get_future().get();
-            if (!data) return std::unexpected(data.error());
+            auto result = writeGroup();
+            if (!result) return result;
+        }
 
-            auto existingData = compress == CompressMode::ADVANCED ? dataMap.find(data->crc) : dataMap.end();
-            auto dataId       = existingData == dataMap.end() ? dataEntries.size() : existingData->second;
+        writer.finish();
+        if (!output) return std::unexpected("Error: failed to write the tar.");
+        return {};
+    }
 
-            treeEntries.push_back({
-                .compareBit = static_cast<decltype(MDB::TreeEntry::compareBit)>(file.compareBit),
-                .dataId     = static_cast<decltype(MDB::TreeEntry::dataId)>(dataId),
-                .left       = static_cast<decltype(MDB::TreeEntry::left)>(file.left),
-                .right      = static_cast<decltype(MDB::TreeEntry::right)>(file.right),
-            });
-            nameEntries.emplace_back(file.name.name);
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::extractSingleFile(const std::filesystem::path& output, std::string file)
+        -> std::expected<void, std::string>
+    {
+        std::ranges::replace(file, '/', '\\');
+        if (!entries.contains(file))
+            return std::unexpected(std::format("File '{}' does not exist in the archive.", file));
+
+        return extractFile(output, entries.at(file));
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::extractSingleFileToStdout(std::string file) -> std::expected<void, std::string>
+    {
+        std::ranges::replace(file, '/', '\\');
+        auto entry = entries.find(file);
+        if (entry == entries.end())
+            return std::unexpected(std::format("File '{}' does not exist in the archive.", file));
+
+        std::cout.flush();
+        const auto& [offset, fullSize, compressedSize, dataId] = entry->second;
+        auto data = std::expected<std::vector<char>, std::string>();
+        if (!IS_ENCRYPTED<MDB> && compressedSize == fullSize)
+        {
+            // whatever couldn't be passed by the kernel is read and written regularly
+            const auto written = sendToStdout(path, dataStart + offset, fullSize);
+            const auto rest    = fullSize - written;
+            data               = readRawEntry({
+                .offset         = offset + written,
+                .fullSize       = rest,
+                .compressedSize = rest,
+                .dataId         = dataId,
+            });
+        }
+        else
+            data = readFile(file);
+
+        if (!data) return std::unexpected(data.error());
+        std::cout.write(data->data(), static_cast<std::streamsize>(data->size()));
+        std::cout.flush();
+        if (!std::cout) return std::unexpected("Error: failed to write to stdout.");
+
+        return {};
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::getFiles() const -> std::vector<std::string>
+    {
+        return entries | std::views::keys | std::ranges::to<std::vector<std::string>>();
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::getFileInfo(std::string file) const -> std::optional<FileInfo>
+    {
+        std::ranges::replace(file, '/', '\\');
+        auto entry = entries.find(file);
+        if (entry == entries.end()) return std::nullopt;
+
+        return FileInfo{
+            .fullSize       = entry->second.fullSize,
+            .compressedSize = entry->second.compressedSize,
+            .dataId         = entry->second.dataId,
+        };
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::readFile(std::string file) -> std::expected<std::vector<char>, std::string>
+    {
+        std::ranges::replace(file, '/', '\\');
+        auto entry = entries.find(file);
+        if (entry == entries.end())
+            return std::unexpected(std::format("File '{}' does not exist in the archive.", file));
+
+        auto result = readEntry(entry->second);
+        if (!result) return std::unexpected(result.error());
+
+        // match the data written by extractFile, which applies the asset encryption on write
+        if constexpr (IS_ENCRYPTED<MDB>) cryptArray(result->data(), result->size(), 0);
+        return result;
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::readRawFile(std::string file) -> std::expected<RawFile, std::string>
+    {
+        std::ranges::replace(file, '/', '\\');
+        auto entry = entries.find(file);
+        if (entry == entries.end())
+            return std::unexpected(std::format("File '{}' does not exist in the archive.", file));
+
+        auto data = readRawEntry(entry->second);
+        if (!data) return std::unexpected(data.error());
+
+        return RawFile{.fullSize = entry->second.fullSize, .data = std::move(data.value())};
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::verify(uint32_t jobs) -> std::expected<VerifyResult, std::string>
+    {
+        if (!input.is_open()) return std::unexpected("Error: failed to read the archive.");
+
+        ArchiveTables<MDB> tables;
+        uint64_t fileSize = 0;
+        {
+            const std::lock_guard lock(inputMutex);
+            input.clear(); // the constructor might have failed to read the tables
+            input.seekg(0, std::ios::end);
+            fileSize = input.tellg();
+            input.seekg(0);
+            tables = readTables<MDB>(input);
+        }
+
+        const auto& [header, treeEntries, nameEntries, dataEntries] = tables;
+        if (header.magicValue != MDB1_MAGIC_VALUE) return std::unexpected("Error: not a valid MDB1 file.");
+        if (!input) return std::unexpected("Error: the file tables are truncated.");
+        if (treeEntries.empty()) return std::unexpected("Error: the archive has no file tree.");
+        if (header.fileEntryCount != header.fileNameCount)
+            return std::unexpected("Error: the number of tree and name entries doesn't match.");
+
+        const auto tableSize = getTableSize<MDB>(treeEntries.size() - 1, dataEntries.size());
+
+        VerifyResult result{.fileCount = 0, .dataCount = dataEntries.size(), .fullSize = 0, .errors = {}};
+        auto& errors = result.errors;
+        if (header.dataStart < tableSize) errors.push_back("Error: the data starts within the file tables.");
+        if (header.dataStart > header.totalSize || header.totalSize > fileSize)
+            errors.push_back(std::format("Error: the total size {} doesn't fit the file size {}.",
+                                         static_cast<uint64_t>(header.totalSize),
+                                         fileSize));
+
+        std::vector<std::string> dataNames(dataEntries.size());
+        for (size_t i = 1; i < treeEntries.size(); i++)
+        {
+            const auto& entry = treeEntries[i];
+            const auto name   = nameEntries[i].toMDB1Path();
+
+            if (entry.left >= treeEntries.size() || entry.right >= treeEntries.size())
+                errors.push_back(std::format("Error: tree entry {} ({}) points outside of the tree.", i, name));
+            else if (findTreeEntry<MDB>(treeEntries, name) != i)
+                errors.push_back(std::format("Error: tree entry {} ({}) can't be found in the tree.", i, name));
+
+            if (entry.dataId == INVALID_DATA_ID<MDB>) continue;
+            if (entry.dataId >= dataEntries.size())
+            {
+                errors.push_back(std::format("Error: tree entry {} ({}) refers to missing data {}.",
+                                             i,
+                                             name,
+                                             static_cast<uint64_t>(entry.dataId)));
+                continue;
+            }
+
+            result.fileCount++;
+            if (dataNames[entry.dataId].empty()) dataNames[entry.dataId] = name;
+        }
+
+        // only data within the archive gets decompressed, everything else is already an error
+        // the bounds are checked in 64 bit and by subtraction, so large offsets can't wrap around
+        std::vector<std::optional<std::string>> dataErrors(dataEntries.size());
+        boost::asio::thread_pool pool(jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : jobs);
+        const uint64_t dataStart = header.dataStart;
+        const uint64_t totalSize = header.totalSize;
+        for (size_t i = 0; i < dataEntries.size(); i++)
+        {
+            const auto& data              = dataEntries[i];
+            const auto name               = dataNames[i].empty() ? std::string("unused") : dataNames[i];
+            const uint64_t offset         = data.offset;
+            const uint64_t compressedSize = data.compressedSize;
+
+            if (dataStart > totalSize || offset > totalSize - dataStart ||
+                compressedSize > totalSize - dataStart - offset)
+            {
+                errors.push_back(std::format("Error: data {} ({}) ends beyond the total size.", i, name));
+                continue;
+            }
+
+            result.fullSize += data.fullSize;
+            ArchiveEntry entry{
+                .offset         = data.offset,
+                .fullSize       = data.fullSize,
+                .compressedSize = data.compressedSize,
+                .dataId         = i,
+            };
+            boost::asio::post(pool,
+                              [this, entry, name, i, &error = dataErrors[i]]
+                              {
+                                  // a corrupt size can make the buffers fail to allocate
+                                  try
+                                  {
+                                      auto file = readEntry(entry);
+                                      if (!file)
+                                          error = std::format("Error: data {} ({}): {}", i, name, file.error());
+                                      else if (file->size() != entry.fullSize)
+                                          error = std::format("Error: data {} ({}) failed to decompress to {} bytes.",
+                                                              i,
+                                                              name,
+                                                              entry.fullSize);
+                                  }
+                                  catch (const std::exception& ex)
+                                  {
+                                      error = std::format("Error: data {} ({}): {}", i, name, ex.what());
+                                  }
+                              });
+        }
+        pool.join();
+
+        for (auto& error : dataErrors)
+            if (error) errors.push_back(std::move(error.value()));
+
+        return result;
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::readEntry(const ArchiveEntry& entry) -> std::expected<std::vector<char>, std::string>
+    {
+        // stored data doesn't need to go through the compressor, which would just copy it
+        auto data = readRawEntry(entry);
+        if (!data || data->size() == entry.fullSize) return data;
+
+        return MDB::Compressor::decompress(data.value(), entry.fullSize);
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::selectEntries(const FileFilter& filter) const
+        -> std::vector<std::pair<std::string, ArchiveEntry>>
+    {
+        auto isSelected = [&filter](const auto& entry) { return filter.matches(entry.first); };
+        auto selected   = entries | std::views::filter(isSelected) |
+                        std::ranges::to<std::vector<std::pair<std::string, ArchiveEntry>>>();
+
+        // the data gets read in the order it's stored in, so the archive is read sequentially instead of seeking all
+        // over the place
+        std::ranges::stable_sort(selected, {}, [](const auto& entry) { return entry.second.offset; });
+        return selected;
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::readRawEntry(const ArchiveEntry& entry) -> std::expected<std::vector<char>, std::string>
+    {
+        std::vector<char> inputData(entry.compressedSize);
+
+        // a failed read would stick to the shared stream and fail all following reads, too
+        const std::lock_guard lock(inputMutex);
+        input.clear();
+        input.seekg(dataStart + entry.offset);
+        input.read(inputData.data(), inputData.size());
+        if (!input)
+        {
+            input.clear();
+            return std::unexpected(std::format("Error: failed to read {} bytes at offset {} of the archive.",
+                                               inputData.size(),
+                                               dataStart + entry.offset));
+        }
+
+        return inputData;
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::extractFile(const std::filesystem::path& output, const ArchiveEntry& entry)
+        -> std::expected<void, std::string>
+    {
+        if (!IS_ENCRYPTED<MDB> && entry.compressedSize == entry.fullSize) return copyStoredFile(output, entry);
+
+        auto result = readEntry(entry);
+        if (!result) return std::unexpected(result.error());
+
+        return writeFile(output, result.value());
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::writeFile(const std::filesystem::path& output, std::vector<char>& data)
+        -> std::expected<void, std::string>
+    {
+        auto prepared = prepareOutputFile(output);
+        if (!prepared) return prepared;
+
+        // the data gets encrypted in place, if the game uses asset encryption
+        typename MDB::OutputStream outputStream(output, std::ios::out | std::ios::binary);
+        outputStream.write(data.data(), data.size());
+        return {};
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveInfo<MDB>::copyStoredFile(const std::filesystem::path& output, const ArchiveEntry& entry)
+        -> std::expected<void, std::string>
+    {
+        auto prepared = prepareOutputFile(output);
+        if (!prepared) return prepared;
+
+        if (copyFileRange(path, dataStart + entry.offset, output, 0, entry.fullSize)) return {};
+
+        auto data = readRawEntry(entry);
+        if (!data) return std::unexpected(data.error());
+
+        return writeFile(output, data.value());
+    }
+
+    template<ArchiveType MDB>
+    void ArchiveBuilder<MDB>::addFile(std::filesystem::path path, std::filesystem::path source)
+    {
+        files.push_back({
+            .path = std::move(path),
+            .load   = [source] { return readFileData(source); },
+            .source = std::move(source),
+        });
+    }
+
+    template<ArchiveType MDB>
+    void ArchiveBuilder<MDB>::addBuffer(std::filesystem::path path, std::vector<char> data)
+    {
+        // the data is only loaded once, so it can be moved out instead of copied
+        files.push_back({
+            .path = std::move(path),
+            .load = [data = std::move(data)]() mutable -> std::expected<std::vector<char>, std::string>
+            { return std::move(data); },
+        });
+    }
+
+    template<ArchiveType MDB>
+    void ArchiveBuilder<MDB>::addGenerated(std::filesystem::path path, FileLoader load)
+    {
+        files.push_back({.path = std::move(path), .load = std::move(load)});
+    }
+
+    template<ArchiveType MDB>
+    void ArchiveBuilder<MDB>::addRaw(std::filesystem::path path, RawFileLoader load)
+    {
+        files.push_back({.path = std::move(path), .loadRaw = std::move(load)});
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveBuilder<MDB>::addDirectory(const std::filesystem::path& source) -> std::expected<void, std::string>
+    {
+        if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source))
+            return std::unexpected("Source path does not exist or is not a directory.");
+
+        for (const auto& i : std::filesystem::recursive_directory_iterator(source))
+        {
+            if (!std::filesystem::is_regular_file(i)) continue;
+
+            addFile(std::filesystem::relative(i.path(), source), i.path());
+        }
+
+        return {};
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveBuilder<MDB>::getFileCount() const -> size_t
+    {
+        return files.size();
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveBuilder<MDB>::build(const std::filesystem::path& target, CompressMode compress, size_t reserve)
+        -> std::expected<void, std::string>
+    {
+        return packArchive<MDB>(std::exchange(files, {}), target, compress, reserve);
+    }
+
+    template<ArchiveType MDB>
+    auto ArchiveBuilder<MDB>::update(const std::filesystem::path& archive, CompressMode compress, size_t reserve)
+        -> std::expected<UpdateResult, std::string>
+    {
+        return updateArchive<MDB>(archive, std::exchange(files, {}), compress, reserve);
+    }
+
+    template<ArchiveType MDB>
+    auto packArchive(const std::filesystem::path& source,
+                     const std::filesystem::path& target,
+                     CompressMode compress,
+                     size_t reserve) -> std::expected<void, std::string>
+    {
+        ArchiveBuilder<MDB> builder;
+        auto result = builder.addDirectory(source);
+        if (!result) return result;
+
+        return builder.build(target, compress, reserve);
+    }
+
+    template<ArchiveType MDB>
+    auto packArchive(std::vector<ArchiveFile> files,
+                     const std::filesystem::path& target,
+                     CompressMode compress,
+                     size_t reserve) -> std::expected<void, std::string>
+    {
+        if (target.has_parent_path() && !std::filesystem::exists(target))
+            std::filesystem::create_directories(target.parent_path());
+
+        std::ranges::sort(files, {}, &ArchiveFile::path);
+
+        std::vector<TreeName> fileNames;
+        for (size_t i = 0; i < files.size(); i++)
+            fileNames.push_back({.name = buildMDB1Path(files[i].path), .index = i});
+
+        auto sortedNames =
+            fileNames | std::views::transform(&TreeName::name) | std::ranges::to<std::vector<std::string>>();
+        std::ranges::sort(sortedNames);
+        if (auto duplicate = std::ranges::adjacent_find(sortedNames); duplicate != sortedNames.end())
+            return std::unexpected(std::format("Error: file {} exists more than once.", *duplicate));
+
+        log("[Pack] Generating File Tree...");
+        auto tree = generateTree(fileNames);
+
+        // files that don't get compressed are copied from their source into the archive by the kernel instead
+        auto isCopied = [&files, compress](size_t index)
+        { return !IS_ENCRYPTED<MDB> && compress == CompressMode::NONE && !files[index].source.empty(); };
+
+        // files sharing their stored data with an earlier one don't get loaded
+        std::set<std::pair<size_t, uint64_t>> sharedLoaded;
+        auto isShared = [&files, &sharedLoaded](size_t index)
+        { return files[index].sharedData && !sharedLoaded.insert(files[index].sharedData.value()).second; };
+
+        // start compressing files, in the order they get written
+        std::vector<size_t> order;
+        for (const auto& file : tree)
+            if (file.compareBit != INVALID && !isCopied(file.name.index) && !isShared(file.name.index))
+                order.push_back(file.name.index);
+
+        // twice the core count to account for blocking threads
+        auto threadCount = std::thread::hardware_concurrency() * 2;
+        boost::asio::thread_pool pool(threadCount);
+        log(std::format("[Pack] Start compressing files with {} threads...", threadCount));
+
+        auto futures = compressFiles<typename MDB::Compressor>(pool, files, order, compress);
+
+        std::vector<typename MDB::TreeEntry> treeEntries;
+        std::vector<typename MDB::NameEntry> nameEntries;
+        std::vector<typename MDB::DataEntry> dataEntries;
+
+        const auto fileCount = files.size();
+        const auto dataStart = getTableSize<MDB>(fileCount + reserve, fileCount + reserve);
+
+        treeEntries.push_back({
+            .compareBit = std::numeric_limits<decltype(MDB::TreeEntry::compareBit)>::max(),
+            .dataId     = std::numeric_limits<decltype(MDB::TreeEntry::dataId)>::max(),
+            .left       = 0,
+            .right      = 1,
+        });
+        nameEntries.push_back({});
+
+        auto fileId = 0;
+        // raw files are checksummed as stored, the sizes keep them apart from uncompressed files
+        std::map<std::tuple<uint32_t, uint64_t, uint64_t>, size_t> dataMap;
+        std::map<std::pair<size_t, uint64_t>, size_t> sharedMap;
+        size_t offset = 0;
+        typename MDB::OutputStream output(target, std::ios::out | std::ios::binary);
+
+        for (const auto& file : tree)
+        {
+            if (file.compareBit == std::numeric_limits<decltype(file.compareBit)>::max()) continue;
+
+            if (fileId++ % 200 == 0) log(std::format("[Pack] Writing File {} of {}", fileId, fileCount));
+
+            auto addTreeEntry = [&](size_t dataId)
+            {
+                treeEntries.push_back({
+                    .compareBit = static_cast<decltype(MDB::TreeEntry::compareBit)>(file.compareBit),
+                    .dataId     = static_cast<decltype(MDB::TreeEntry::dataId)>(dataId),
+                    .left       = static_cast<decltype(MDB::TreeEntry::left)>(file.left),
+                    .right      = static_cast<decltype(MDB::TreeEntry::right)>(file.right),
+                });
+                nameEntries.emplace_back(file.name.name);
+            };
+
+            const auto& sharedData = files[file.name.index].sharedData;
+            auto shared            = sharedData ? sharedMap.find(sharedData.value()) : sharedMap.end();
+            if (shared != sharedMap.end())
+            {
+                addTreeEntry(shared->second);
+                continue;
+            }
+
+            const auto copied = isCopied(file.name.index);
+            auto data         = copied ? getSourceSize(files[file.name.index]) : futures[file.name.index].get();
+            if (!data) return std::unexpected(data.error());
+            const auto storedSize = copied ? data->originalSize : data->data.size();
+            auto dataKey          = std::tuple(data->crc, data->originalSize, storedSize);
+            auto existingData = compress == CompressMode::ADVANCED ? dataMap.find(dataKey) : dataMap.end();
+            auto dataId       = existingData == dataMap.end() ? dataEntries.size() : existingData->second;
+
+            if (sharedData) sharedMap[sharedData.value()] = dataId;
+            addTreeEntry(dataId);
             if (existingData == dataMap.end())
             {
-                dataMap[data->crc] = dataId;
+                dataMap[dataKey] = dataId;
                 dataEntries.push_back({
                     .offset         = static_cast<decltype(MDB::DataEntry::offset)>(offset),
                     .fullSize       = static_cast<decltype(MDB::DataEntry::fullSize)>(data->originalSize),
-                    .compressedSize = static_cast<decltype(MDB::DataEntry::compressedSize)>(data->data.size()),
+                    .compressedSize = static_cast<decltype(MDB::DataEntry::compressedSize)>(storedSize),
                 });
 
+                if (copied && !copyFileRange(files[file.name.index].source, 0, target, dataStart + offset, storedSize))
+                {
+                    data = getFileData<typename MDB::Compressor>(files[file.name.index], compress);
+                    if (!data) return std::unexpected(data.error());
+                    if (data->data.size() != storedSize)
+                        return std::unexpected(std::format("Error: file {} changed while packing.",
+                                                           files[file.name.index].path.string()));
+                }
+
+                output.seekp(dataStart + offset);
+                output.write(data->data.data(), data->data.size());
+                offset += storedSize;
+            }
+        }
+
+        ArchiveTables<MDB> tables{
+            .header =
+                {
+                    .fileEntryCount = static_cast<decltype(MDB::Header::fileEntryCount)>(treeEntries.size()),
+                    .fileNameCount  = static_cast<decltype(MDB::Header::fileNameCount)>(nameEntries.size()),
+                    .dataEntryCount = static_cast<decltype(MDB::Header::dataEntryCount)>(dataEntries.size()),
+                    .dataStart      = static_cast<decltype(MDB::Header::dataStart)>(dataStart),
+                    .totalSize      = static_cast<decltype(MDB::Header::totalSize)>(dataStart + offset),
+                },
+            .treeEntries = std::move(treeEntries),
+            .nameEntries = std::move(nameEntries),
+            .dataEntries = std::move(dataEntries),
+        };
+        writeTables(output, tables);
+        return {};
+    }
+
+    template<ArchiveType MDB>
+    auto mergeArchives(const std::vector<std::filesystem::path>& sources,
+                       const std::filesystem::path& target,
+                       CompressMode compress) -> std::expected<void, std::string>
+    {
+        // the archives must stay open until everything is written
+        std::vector<std::unique_ptr<ArchiveInfo<MDB>>> archives;
+        std::map<std::string, ArchiveFile> files;
+        size_t overridden = 0;
+
+        auto addFile = [&](ArchiveFile file)
+        {
+            auto name = buildMDB1Path(file.path);
+            if (files.contains(name)) overridden++;
+            files.insert_or_assign(name, std::move(file));
+        };
+
+        for (const auto& source : sources)
+        {
+            if (file_equivalent(source, target))
+                return std::unexpected(std::format("Error: {} is both source and target.", source.string()));
+
+            if (std::filesystem::is_directory(source))
+            {
+                for (const auto& i : std::filesystem::recursive_directory_iterator(source))
+                {
+                    if (!std::filesystem::is_regular_file(i)) continue;
+
+                    auto path = i.path();
+                    addFile({
+                        .path = std::filesystem::relative(path, source),
+                        .load = [path] { return readFileData(path); },
+                    });
+                }
+            }
+            else if (std::filesystem::is_regular_file(source))
+            {
+                auto* archive = archives.emplace_back(std::make_unique<ArchiveInfo<MDB>>(source)).get();
+                if (!archive->isValid())
+                    return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", source.string()));
+
+                // files sharing a data entry in the source keep sharing it
+                for (const auto& name : archive->getFiles())
+                {
+                    auto path = name;
+                    std::ranges::replace(path, '\\', '/');
+                    addFile({
+                        .path       = path,
+                        .loadRaw    = [archive, name] { return archive->readRawFile(name); },
+                        .sharedData = std::pair(archives.size() - 1, archive->getFileInfo(name)->dataId),
+                    });
+                }
+            }
+            else
+                return std::unexpected(std::format("Error: {} does not exist.", source.string()));
+        }
+
+        log(std::format("[Merge] Merging {} files, {} overridden by later sources.", files.size(), overridden));
+
+        std::vector<ArchiveFile> fileList;
+        fileList.reserve(files.size());
+        for (auto& file : files | std::views::values)
+            fileList.push_back(std::move(file));
+
+        return packArchive<MDB>(std::move(fileList), target, compress);
+    }
+
+    template<ArchiveType MDB>
+    auto compactArchive(const std::filesystem::path& source, const std::filesystem::path& target, bool deduplicate)
+        -> std::expected<CompactResult, std::string>
+    {
+        using DataEntry = typename MDB::DataEntry;
+
+        if (std::filesystem::exists(target) && std::filesystem::equivalent(source, target))
+            return std::unexpected(std::format("Error: {} is both source and target.", source.string()));
+
+        typename MDB::InputStream input(source, std::ios::in | std::ios::binary);
+        if (!input) return std::unexpected(std::format("Error: failed to open {}.", source.string()));
+
+        auto tables = readTables<MDB>(input);
+        if (!input || tables.header.magicValue != MDB1_MAGIC_VALUE)
+            return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", source.string()));
+
+        std::vector<bool> referenced(tables.dataEntries.size());
+        for (const auto& entry : tables.treeEntries)
+        {
+            if (entry.dataId == INVALID_DATA_ID<MDB>) continue;
+            if (entry.dataId >= referenced.size())
+                return std::unexpected(std::format("Error: a file refers to missing data entry {}.", entry.dataId));
+
+            referenced[entry.dataId] = true;
+        }
+
+        // keep the data in its original order, so it gets read sequentially
+        std::vector<size_t> used;
+        for (size_t i = 0; i < referenced.size(); i++)
+            if (referenced[i]) used.push_back(i);
+        std::ranges::sort(used, {}, [&](auto id) { return tables.dataEntries[id].offset; });
+
+        auto readData = [&](size_t id) -> std::expected<std::vector<char>, std::string>
+        {
+            const auto& entry = tables.dataEntries[id];
+
+            std::vector<char> data(entry.compressedSize);
+            input.seekg(tables.header.dataStart + entry.offset);
+            input.read(data.data(), data.size());
+            if (!input) return std::unexpected(std::format("Error: failed to read data entry {}.", id));
+            return data;
+        };
+
+        // find the entries to keep first, so the tables only get space for them. Entries with the same checksum and
+        // sizes are only merged if their data is identical.
+        std::vector<size_t> kept;
+        std::vector<size_t> idMap(tables.dataEntries.size());
+        std::map<std::tuple<uint32_t, uint64_t, uint64_t>, std::vector<size_t>> dataMap;
+        size_t mergedEntries = 0;
+
+        for (auto id : used)
+        {
+            if (deduplicate)
+            {
+                const auto& entry = tables.dataEntries[id];
+
+                auto data = readData(id);
+                if (!data) return std::unexpected(data.error());
+
+                auto& candidates = dataMap[std::tuple(getChecksum(*data), entry.fullSize, entry.compressedSize)];
+                std::optional<size_t> match;
+                for (auto index : candidates)
+                {
+                    auto other = readData(kept[index]);
+                    if (!other) return std::unexpected(other.error());
+                    if (*other != *data) continue;
+
+                    match = index;
+                    break;
+                }
+
+                if (match)
+                {
+                    idMap[id] = match.value();
+                    mergedEntries++;
+                    continue;
+                }
+                candidates.push_back(kept.size());
+            }
+
+            idMap[id] = kept.size();
+            kept.push_back(id);
+        }
+
+        const auto dataStart = sizeof(typename MDB::Header) +
+                               (sizeof(typename MDB::TreeEntry) * tables.treeEntries.size()) +
+                               (sizeof(typename MDB::NameEntry) * tables.nameEntries.size()) +
+                               (sizeof(DataEntry) * kept.size());
+
+        std::vector<DataEntry> dataEntries;
+        uint64_t offset = 0;
+
+        typename MDB::OutputStream output(target, std::ios::out | std::ios::binary);
+        if (!output) return std::unexpected(std::format("Error: failed to open {}.", target.string()));
+
+        for (auto id : kept)
+        {
+            const auto& entry = tables.dataEntries[id];
+
+            auto data = readData(id);
+            if (!data) return std::unexpected(data.error());
+
+            dataEntries.push_back({
+                .offset         = static_cast<decltype(DataEntry::offset)>(offset),
+                .fullSize       = entry.fullSize,
+                .compressedSize = entry.compressedSize,
+            });
+
+            output.seekp(dataStart + offset);
+            output.write(data->data(), data->size());
+            offset += data->size();
+        }
+
+        for (auto& entry : tables.treeEntries)
+            if (entry.dataId != INVALID_DATA_ID<MDB>)
+                entry.dataId = static_cast<decltype(MDB::TreeEntry::dataId)>(idMap[entry.dataId]);
+
+        const auto removedEntries = tables.dataEntries.size() - used.size();
+
+        tables.dataEntries           = std::move(dataEntries);
+        tables.header.dataEntryCount = static_cast<decltype(MDB::Header::dataEntryCount)>(tables.dataEntries.size());
+        tables.header.dataStart      = static_cast<decltype(MDB::Header::dataStart)>(dataStart);
+        tables.header.totalSize      = static_cast<decltype(MDB::Header::totalSize)>(dataStart + offset);
+        writeTables(output, tables);
+
+        if (!output) return std::unexpected(std::format("Error: failed to write {}.", target.string()));
+
+        return CompactResult{
+            .removedEntries = removedEntries,
+            .mergedEntries  = mergedEntries,
+            .oldSize        = std::filesystem::file_size(source),
+            .newSize        = dataStart + offset,
+        };
+    }
+
+    template<ArchiveType MDB>
+    auto updateArchive(const std::filesystem::path& archive,
+                       std::vector<ArchiveFile> files,
+                       CompressMode compress,
+                       size_t reserve) -> std::expected<UpdateResult, std::string>
+    {
+        if (compress == CompressMode::ADVANCED)
+            return std::unexpected("Error: advanced compression can't be used to update an archive.");
+
+        ArchiveTables<MDB> tables;
+        {
+            typename MDB::InputStream input(archive, std::ios::in | std::ios::binary);
+            if (!input) return std::unexpected(std::format("Error: failed to open {}.", archive.string()));
+
+            tables = readTables<MDB>(input);
+            const auto& header = tables.header;
+            if (!input || header.magicValue != MDB1_MAGIC_VALUE || header.dataStart > header.totalSize ||
+                header.totalSize > std::filesystem::file_size(archive))
+                return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", archive.string()));
+        }
+
+        std::ranges::sort(files, {}, &ArchiveFile::path);
+
+        auto newNames = files | std::views::transform([](const auto& file) { return buildMDB1Path(file.path); }) |
+                        std::ranges::to<std::vector<std::string>>();
+        if (auto duplicate = std::ranges::adjacent_find(newNames); duplicate != newNames.end())
+            return std::unexpected(std::format("Error: file {} exists more than once.", *duplicate));
+
+        std::map<std::string, uint64_t> dataIds;
+        std::vector<size_t> references(tables.dataEntries.size());
+        for (size_t i = 0; i < tables.treeEntries.size(); i++)
+        {
+            auto dataId = tables.treeEntries[i].dataId;
+            if (dataId == INVALID_DATA_ID<MDB>) continue;
+            if (dataId >= references.size())
+                return std::unexpected(std::format("Error: a file refers to missing data entry {}.", dataId));
+
+            dataIds[tables.nameEntries[i].toMDB1Path()] = dataId;
+            references[dataId]++;
+        }
+
+        // the data of new files gets appended, replaced files reuse their data entry unless it's shared
+        std::vector<uint64_t> newDataIds;
+        size_t replacedFiles = 0;
+        size_t dataCount     = tables.dataEntries.size();
+        for (const auto& name : newNames)
+        {
+            auto existing = dataIds.find(name);
+            if (existing != dataIds.end()) replacedFiles++;
+
+            if (existing != dataIds.end() && references[existing->second] == 1)
+                newDataIds.push_back(existing->second);
+            else
+                newDataIds.push_back(dataCount++);
+
+            dataIds[name] = newDataIds.back();
+        }
+
+        if (dataIds.size() + 1 > std::numeric_limits<decltype(MDB::Header::fileEntryCount)>::max())
+            return std::unexpected("Error: too many files for this archive type.");
+
+        std::vector<TreeName> fileNames;
+        std::vector<uint64_t> fileDataIds;
+        for (const auto& [name, dataId] : dataIds)
+        {
+            fileNames.push_back({.name = name, .index = fileNames.size()});
+            fileDataIds.push_back(dataId);
+        }
+
+        log("[Update] Generating File Tree...");
+        auto tree = generateTree(fileNames);
+
+        // the data is only moved when the new tables and the reserved space don't fit in front of it
+        const auto fileCount   = fileNames.size();
+        const auto oldStart    = static_cast<uint64_t>(tables.header.dataStart);
+        const auto rewritten   = getTableSize<MDB>(fileCount + reserve, dataCount + reserve) > oldStart;
+        const auto dataStart   = rewritten ? getTableSize<MDB>(fileCount + reserve, dataCount + reserve) : oldStart;
+        const auto oldDataSize = static_cast<uint64_t>(tables.header.totalSize) - oldStart;
+        const auto outputPath  = rewritten ? std::filesystem::path(archive).concat(".tmp") : archive;
+
+        auto threadCount = std::thread::hardware_concurrency() * 2;
+        boost::asio::thread_pool pool(threadCount);
+        log(std::format("[Update] Start compressing {} files with {} threads...", files.size(), threadCount));
+
+        auto order   = std::views::iota(size_t{0}, files.size()) | std::ranges::to<std::vector<size_t>>();
+        auto futures = compressFiles<typename MDB::Compressor>(pool, files, order, compress);
+
+        auto writeArchive = [&]() -> std::expected<void, std::string>
+        {
+            // when updating in place the new data is appended behind the old data, so the archive stays intact until
+            // the tables get written at the very end, after syncing the data. A failure while writing the tables
+            // leaves it corrupt.
+            auto mode = rewritten ? std::ios::out | std::ios::binary : std::ios::in | std::ios::out | std::ios::binary;
+            typename MDB::OutputStream output(outputPath, mode);
+            if (!output) return std::unexpected(std::format("Error: failed to open {}.", outputPath.string()));
+
+            if (rewritten)
+            {
+                log("[Update] Tables don't fit in front of the data, rewriting archive...");
+
+                typename MDB::InputStream input(archive, std::ios::in | std::ios::binary);
+                std::vector<char> buffer(16 * 1024 * 1024);
+                input.seekg(oldStart);
+                output.seekp(dataStart);
+
+                for (uint64_t copied = 0; copied < oldDataSize;)
+                {
+                    auto size = std::min<uint64_t>(buffer.size(), oldDataSize - copied);
+                    input.read(buffer.data(), size);
+                    output.write(buffer.data(), size);
+                    copied += size;
+                }
+
+                if (!input) return std::unexpected(std::format("Error: failed to read {}.", archive.string()));
+            }
+
+            uint64_t offset = oldDataSize;
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                auto data = futures[i].get();
+                if (!data) return std::unexpected(data.error());
+
+                typename MDB::DataEntry entry = {
+                    .offset         = static_cast<decltype(MDB::DataEntry::offset)>(offset),
+                    .fullSize       = static_cast<decltype(MDB::DataEntry::fullSize)>(data->originalSize),
+                    .compressedSize = static_cast<decltype(MDB::DataEntry::compressedSize)>(data->data.size()),
+                };
+
+                if (newDataIds[i] < tables.dataEntries.size())
+                    tables.dataEntries[newDataIds[i]] = entry;
+                else
+                    tables.dataEntries.push_back(entry);
+
                 output.seekp(dataStart + offset);
                 output.write(data->data.data(), data->data.size());
                 offset += data->data.size();
             }
+
+            tables.treeEntries.clear();
+            tables.nameEntries.clear();
+            tables.treeEntries.push_back({
+                .compareBit = std::numeric_limits<decltype(MDB::TreeEntry::compareBit)>::max(),
+                .dataId     = INVALID_DATA_ID<MDB>,
+                .left       = 0,
+                .right      = 1,
+            });
+            tables.nameEntries.push_back({});
+
+            for (const auto& file : tree)
+            {
+                if (file.compareBit == INVALID) continue;
+
+                tables.treeEntries.push_back({
+                    .compareBit = static_cast<decltype(MDB::TreeEntry::compareBit)>(file.compareBit),
+                    .dataId     = static_cast<decltype(MDB::TreeEntry::dataId)>(fileDataIds[file.name.index]),
+                    .left       = static_cast<decltype(MDB::TreeEntry::left)>(file.left),
+                    .right      = static_cast<decltype(MDB::TreeEntry::right)>(file.right),
+                });
+                tables.nameEntries.emplace_back(file.name.name);
+            }
+
+            auto& header          = tables.header;
+            header.fileEntryCount = static_cast<decltype(MDB::Header::fileEntryCount)>(tables.treeEntries.size());
+            header.fileNameCount  = static_cast<decltype(MDB::Header::fileNameCount)>(tables.nameEntries.size());
+            header.dataEntryCount = static_cast<decltype(MDB::Header::dataEntryCount)>(tables.dataEntries.size());
+            header.dataStart      = static_cast<decltype(MDB::Header::dataStart)>(dataStart);
+            header.totalSize      = static_cast<decltype(MDB::Header::totalSize)>(dataStart + offset);
+            writeTables(output, tables, rewritten ? std::filesystem::path() : outputPath);
+
+            if (!output) return std::unexpected(std::format("Error: failed to write {}.", outputPath.string()));
+            return {};
+        };
+
+        auto result = writeArchive();
+        if (!result)
+        {
+            if (rewritten) std::filesystem::remove(outputPath);
+            return std::unexpected(result.error());
+        }
+
+        if (rewritten) std::filesystem::rename(outputPath, archive);
+
+        return UpdateResult{
+            .addedFiles    = files.size() - replacedFiles,
+            .replacedFiles = replacedFiles,
+            .rewritten     = rewritten,
+        };
+    }
+
+    template<ArchiveType MDB>
+    auto createPatch(const std::filesystem::path& base,
+                     const std::filesystem::path& archive,
+                     const std::filesystem::path& patch) -> std::expected<PatchSummary, std::string>
+    {
+        for (const auto& source : {base, archive})
+            if (file_equivalent(source, patch))
+                return std::unexpected(std::format("Error: {} is both source and target.", source.string()));
+
+        ArchiveInfo<MDB> baseInfo(base);
+        ArchiveInfo<MDB> archiveInfo(archive);
+        if (!baseInfo.isValid())
+            return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", base.string()));
+        if (!archiveInfo.isValid())
+            return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", archive.string()));
+
+        auto baseChecksum = getTableChecksum<MDB>(base);
+        if (!baseChecksum) return std::unexpected(baseChecksum.error());
+
+        auto baseFiles    = baseInfo.getFiles();
+        auto archiveFiles = archiveInfo.getFiles();
+
+        if (patch.has_parent_path()) std::filesystem::create_directories(patch.parent_path());
+        std::ofstream output(patch, std::ios::out | std::ios::binary);
+        if (!output) return std::unexpected(std::format("Error: failed to open {}.", patch.string()));
+
+        PatchHeader header{.baseSize = std::filesystem::file_size(base), .baseChecksum = baseChecksum.value()};
+        PatchSummary summary{};
+        std::map<uint64_t, uint64_t> dependencies;
+        write(output, header);
+
+        auto writeEntry = [&](PatchEntryType type, const std::string& name)
+        {
+            write(output, type);
+            write(output, static_cast<uint32_t>(name.size()));
+            write(output, name.data(), static_cast<std::streamsize>(name.size()));
+            header.entryCount++;
+        };
+
+        for (const auto& name : baseFiles)
+        {
+            if (std::ranges::binary_search(archiveFiles, name)) continue;
+
+            writeEntry(PatchEntryType::REMOVED, name);
+            summary.removedFiles++;
+        }
+
+        for (const auto& name : archiveFiles)
+        {
+            auto type     = PatchEntryType::ADDED;
+            auto baseFile = baseInfo.getFileInfo(name);
+            auto file     = archiveInfo.getFileInfo(name).value();
+
+            auto data = archiveInfo.readRawFile(name);
+            if (!data) return std::unexpected(data.error());
+
+            // only compare the data if the sizes match
+            if (baseFile)
+            {
+                type = PatchEntryType::REPLACED;
+
+                if (baseFile->fullSize == file.fullSize && baseFile->compressedSize == file.compressedSize)
+                {
+                    auto baseData = baseInfo.readRawFile(name);
+                    if (!baseData) return std::unexpected(baseData.error());
+                    if (baseData->data == data->data)
+                    {
+                        dependencies[baseFile->dataId] = getChecksum64(baseData->data);
+                        continue;
+                    }
+                }
+            }
+
+            writeEntry(type, name);
+            write(output, data->fullSize);
+            write(output, static_cast<uint64_t>(data->data.size()));
+            write(output, data->data);
+
+            summary.dataSize += data->data.size();
+            if (type == PatchEntryType::ADDED)
+                summary.addedFiles++;
+            else
+                summary.replacedFiles++;
         }
 
+        // the data of the files kept from the base must match when applying the patch
+        for (const auto& [dataId, checksum] : dependencies)
+            write(output, PatchDependency{.dataId = dataId, .checksum = checksum});
+        header.dependencyCount = dependencies.size();
+
         output.seekp(0);
-        typename MDB::Header header = {
-            .fileEntryCount = static_cast<decltype(MDB::Header::fileEntryCount)>(treeEntries.size()),
-            .fileNameCount  = static_cast<decltype(MDB::Header::fileNameCount)>(nameEntries.size()),
-            .dataEntryCount = static_cast<decltype(MDB::Header::dataEntryCount)>(dataEntries.size()),
-            .dataStart      = static_cast<decltype(MDB::Header::dataStart)>(dataStart),
-            .totalSize      = static_cast<decltype(MDB::Header::totalSize)>(dataStart + offset),
+        write(output, header);
+
+        if (!output) return std::unexpected(std::format("Error: failed to write {}.", patch.string()));
+        return summary;
+    }
+
+    template<ArchiveType MDB>
+    auto applyPatch(const std::filesystem::path& base,
+                    const std::filesystem::path& patch,
+                    const std::filesystem::path& target) -> std::expected<PatchSummary, std::string>
+    {
+        for (const auto& source : {base, patch})
+            if (std::filesystem::exists(target) && std::filesystem::equivalent(source, target))
+                return std::unexpected(std::format("Error: {} is both source and target.", source.string()));
+
+        auto toPath = [](std::string name)
+        {
+            std::ranges::replace(name, '\\', '/');
+            return std::filesystem::path(name);
         };
 
-        output.write(reinterpret_cast<char*>(&header), headerSize);
-        output.write(reinterpret_cast<char*>(treeEntries.data()), treeEntries.size() * sizeof(typename MDB::TreeEntry));
-        output.write(reinterpret_cast<char*>(nameEntries.data()), nameEntries.size() * sizeof(typename MDB::NameEntry));
-        output.write(reinterpret_cast<char*>(dataEntries.data()), dataEntries.size() * sizeof(typename MDB::DataEntry));
-        return {};
+        ArchiveInfo<MDB> baseInfo(base);
+        if (!baseInfo.isValid())
+            return std::unexpected(std::format("Error: {} is not a valid MDB1 file.", base.string()));
+
+        // the base data is checked against the dependencies when it gets loaded, so it's only read once
+        std::map<uint64_t, uint64_t> dependencies;
+        auto loadBase = [&baseInfo, &dependencies, &base](const std::string& name, uint64_t dataId)
+        {
+            return [&baseInfo, &dependencies, &base, name, dataId]() -> std::expected<RawFile, std::string>
+            {
+                auto file       = baseInfo.readRawFile(name);
+                auto dependency = dependencies.find(dataId);
+                if (file && (dependency == dependencies.end() || dependency->second != getChecksum64(file->data)))
+                    return std::unexpected(std::format("Error: the patch was created for a different version of {}.",
+                                                       base.string()));
+                return file;
+            };
+        };
+
+        std::map<std::string, ArchiveFile> files;
+        for (const auto& name : baseInfo.getFiles())
+        {
+            const auto dataId = baseInfo.getFileInfo(name)->dataId;
+            files[name]       = {
+                .path       = toPath(name),
+                .loadRaw    = loadBase(name, dataId),
+                .sharedData = std::pair(size_t{0}, dataId),
+            };
+        }
+
+        std::ifstream input(patch, std::ios::in | std::ios::binary);
+        auto patchSize = std::filesystem::exists(patch) ? std::filesystem::file_size(patch) : 0;
+        auto header    = read<PatchHeader>(input);
+        if (!input || header.magicValue != PATCH_MAGIC_VALUE || header.version != PATCH_VERSION)
+            return std::unexpected(std::format("Error: {} is not a valid patch file.", patch.string()));
+
+        auto baseChecksum = getTableChecksum<MDB>(base);
+        if (!baseChecksum) return std::unexpected(baseChecksum.error());
+        if (header.baseSize != std::filesystem::file_size(base) || header.baseChecksum != baseChecksum.value())
+            return std::unexpected(std::format("Error: the patch was created for a different version of {}.",
+                                               base.string()));
+
+        PatchSummary summary{};
+        for (uint64_t i = 0; i < header.entryCount; i++)
+        {
+            auto type     = read<PatchEntryType>(input);
+            auto nameSize = read<uint32_t>(input);
+            if (!input || nameSize > patchSize - static_cast<uint64_t>(input.tellg()))
+                return std::unexpected(std::format("Error: {} is truncated.", patch.string()));
+            if (type != PatchEntryType::ADDED && type != PatchEntryType::REMOVED && type != PatchEntryType::REPLACED)
+                return std::unexpected(std::format("Error: {} contains an unknown entry type {}.",
+                                                   patch.string(),
+                                                   static_cast<uint32_t>(type)));
+
+            std::string name(nameSize, '\0');
+            input.read(name.data(), static_cast<std::streamsize>(name.size()));
+            if (!input) return std::unexpected(std::format("Error: {} is truncated.", patch.string()));
+
+            if ((type == PatchEntryType::ADDED) == files.contains(name))
+                return std::unexpected(std::format("Error: the patch doesn't match the archive, at file {}.", name));
+
+            if (type == PatchEntryType::REMOVED)
+            {
+                files.erase(name);
+                summary.removedFiles++;
+                continue;
+            }
+
+            auto fullSize = read<uint64_t>(input);
+            auto size     = read<uint64_t>(input);
+            auto offset   = input.tellg();
+            if (!input || static_cast<uint64_t>(offset) + size > patchSize)
+                return std::unexpected(std::format("Error: {} is truncated.", patch.string()));
+
+            input.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+
+            auto load = [patch, offset, fullSize, size]() -> std::expected<RawFile, std::string>
+            {
+                std::ifstream stream(patch, std::ios::in | std::ios::binary);
+                RawFile file{.fullSize = fullSize, .data = std::vector<char>(size)};
+                stream.seekg(offset);
+                stream.read(file.data.data(), static_cast<std::streamsize>(size));
+                if (!stream) return std::unexpected(std::format("Error: failed to read {}.", patch.string()));
+
+                return file;
+            };
+
+            files.insert_or_assign(name, ArchiveFile{.path = toPath(name), .loadRaw = load});
+            summary.dataSize += size;
+            if (type == PatchEntryType::ADDED)
+                summary.addedFiles++;
+            else
+                summary.replacedFiles++;
+        }
+
+        for (uint64_t i = 0; i < header.dependencyCount; i++)
+        {
+            auto dependency = read<PatchDependency>(input);
+            if (!input) break;
+            dependencies[dependency.dataId] = dependency.checksum;
+        }
+
+        if (!input) return std::unexpected(std::format("Error: {} is truncated.", patch.string()));
+
+        std::vector<ArchiveFile> fileList;
+        fileList.reserve(files.size());
+        for (auto& file : files | std::views::values)
+            fileList.push_back(std::move(file));
+
+        auto result = packArchive<MDB>(std::move(fileList), target, CompressMode::NORMAL);
+        if (!result) return std::unexpected(result.error());
+
+        return summary;
     }
 } // namespace mvgltools::mdb1
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+
+namespace mvgltools::tar
+{
+    /**
+     * Writes a POSIX tar stream of regular files and hard links. Entries are written in the ustar format, names and
+     * sizes that don't fit into it get a pax extended header.
+     */
+    class TarWriter
+    {
+    public:
+        /**
+         * @param output the stream to write to, opened in binary mode
+         * @param mtime the modification time of all entries, in seconds since the epoch
+         */
+        TarWriter(std::ostream& output, int64_t mtime);
+
+        /**
+         * Write a regular file.
+         *
+         * @param name the path of the file within the tar, using '/' as separator
+         */
+        void addFile(const std::string& name, std::span<const char> data);
+
+        /**
+         * Write a hard link to a file that was written before.
+         */
+        void addHardLink(const std::string& name, const std::string& target);
+
+        /**
+         * Write the end of archive marker, no entries may be added afterwards.
+         */
+        void finish();
+
+    private:
+        std::ostream& output;
+        int64_t mtime;
+
+        void writeHeader(const std::string& name, uint64_t size, char type, const std::string& linkName);
+        void writeData(std::span<const char> data);
+    };
+} // namespace mvgltools::tar
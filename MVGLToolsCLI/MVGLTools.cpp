@@ -5,6 +5,8 @@
 #include "SaveFile.h"
 
 #include <boost/any.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/program_options/errors.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
@@ -14,9 +16,13 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree_fwd.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <chrono>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <expected>
 #include <filesystem>
@@ -24,10 +30,18 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <ostream>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 namespace
 {
     enum class GameMode
@@ -45,6 +59,15 @@ namespace
         PACK_MVGL,
         UNPACK_MVGL,
         UNPACK_MVGL_FILE,
+        PACK_MVGL_CSV,
+        UNPACK_MVGL_CSV,
+        MERGE_MVGL,
+        COMPACT_MVGL,
+        UPDATE_MVGL,
+        DIFF_MVGL,
+        APPLY_MVGL_PATCH,
+        CONVERT_MVGL,
+        VERIFY_MVGL,
 
         PACK_MBE,
         PACK_MBE_DIR,
@@ -64,6 +87,34 @@ namespace
         INVALID,
     };
 
+    enum class OutputFormat
+    {
+        FOLDER,
+        TAR,
+    };
+
+    // the output path that writes to stdout instead of a file
+    constexpr std::string_view STDOUT_PATH = "-";
+
+    /**
+     * Get stdout for writing binary data to.
+     */
+    auto getBinaryStdout() -> std::ostream&
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        return std::cout;
+    }
+
+    /**
+     * Get the stream to print errors to, which can't be stdout when the output is written to it.
+     */
+    auto getErrorStream(const std::filesystem::path& target) -> std::ostream&
+    {
+        return target == STDOUT_PATH ? std::cerr : std::cout;
+    }
+
     template<typename T>
     concept AFS2Module = requires(const std::filesystem::path& source, const std::filesystem::path& target) {
         { T::pack(source, target) } -> std::same_as<std::expected<void, std::string>>;
@@ -74,6 +125,9 @@ namespace
     concept FileCryptModule = requires(const std::filesystem::path& source, const std::filesystem::path& target) {
         { T::encrypt(source, target) } -> std::same_as<std::expected<void, std::string>>;
         { T::decrypt(source, target) } -> std::same_as<std::expected<void, std::string>>;
+        {
+            T::convertArchive(source, target)
+        } -> std::same_as<std::expected<mvgltools::mdb1::ArchiveEncryption, std::string>>;
     };
 
     template<typename T>
@@ -231,6 +285,13 @@ namespace
         {
             return std::unexpected("Not supported");
         }
+
+        static auto convertArchive([[maybe_unused]] const std::filesystem::path& source,
+                                   [[maybe_unused]] const std::filesystem::path& target)
+            -> std::expected<mvgltools::mdb1::ArchiveEncryption, std::string>
+        {
+            return std::unexpected("Not supported");
+        }
     };
 
     struct DSCSFileCryptor
@@ -239,26 +300,18 @@ namespace
             -> std::expected<void, std::string>
         {
             if (!std::filesystem::is_regular_file(source)) return std::unexpected("Input path is not a file.");
+
+            // the input stream applies the keystream while reading, so the data gets written as it is
+            mvgltools::mdb1::DSCS::InputStream input(source, std::ios::binary | std::ios::in);
+            if (target == STDOUT_PATH) return cryptStream(input, getBinaryStdout());
+
             if (std::filesystem::exists(target) && !std::filesystem::is_regular_file(target))
                 return std::unexpected("Output path exists and is not a file.");
             if (mvgltools::file_equivalent(source, target))
                 return std::unexpected("Input and output file must be different.");
 
-            mvgltools::mdb1::DSCS::InputStream input(source, std::ios::binary | std::ios::in);
-            mvgltools::mdb1::DSCS::OutputStream output(target, std::ios::binary | std::ios::out);
-
-            std::streamsize offset = 0;
-            std::array<char, 0x2000> inArr{};
-
-            while (!input.eof())
-            {
-                input.read(inArr.data(), 0x2000);
-                auto count = input.gcount();
-                output.write(inArr.data(), count);
-                offset += count;
-            }
-
-            return {};
+            std::ofstream output(target, std::ios::binary | std::ios::out);
+            return cryptStream(input, output);
         }
 
         static auto decrypt(const std::filesystem::path& source, const std::filesystem::path& target)
@@ -266,6 +319,32 @@ namespace
         {
             return encrypt(source, target);
         }
+
+        static auto convertArchive(const std::filesystem::path& source, const std::filesystem::path& target)
+            -> std::expected<mvgltools::mdb1::ArchiveEncryption, std::string>
+        {
+            return mvgltools::mdb1::convertArchiveEncryption(source, target);
+        }
+
+    private:
+        static auto cryptStream(mvgltools::mdb1::DSCS::InputStream& input, std::ostream& output)
+            -> std::expected<void, std::string>
+        {
+            if (!input) return std::unexpected("Failed to open the input.");
+
+            std::array<char, 0x2000> buffer{};
+            while (input)
+            {
+                input.read(buffer.data(), buffer.size());
+                if (input.gcount() == 0) break;
+                output.write(buffer.data(), input.gcount());
+            }
+            if (input.bad()) return std::unexpected("Failed to read the input.");
+
+            output.flush();
+            if (!output) return std::unexpected("Failed to write the output.");
+            return {};
+        }
     };
 
     struct DSTSModule
@@ -304,121 +383,444 @@ namespace
         using AFS2Module      = DSCSAFS2Packer;
     };
 
+    /**
+     * Runs the given function for every path on a thread pool of the given size and collects the results in order.
+     * A job count of 0 uses the hardware concurrency.
+     */
+    template<typename Func>
+    auto runParallel(const std::vector<std::filesystem::path>& paths, uint32_t jobs, Func func)
+        -> std::vector<std::expected<void, std::string>>
+    {
+        std::vector<std::expected<void, std::string>> results(paths.size());
+        boost::asio::thread_pool pool(jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : jobs);
+
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            auto lambda = [&, i]
+            {
+                try
+                {
+                    results[i] = func(paths[i]);
+                }
+                catch (std::exception& ex)
+                {
+                    results[i] = std::unexpected(ex.what());
+                }
+            };
+            boost::asio::post(pool, lambda);
+        }
+
+        pool.join();
+        return results;
+    }
+
+    /**
+     * Builds the file filter of unpack-mvgl from the --include and --exclude patterns. Patterns starting with '@' name
+     * a file listing one path per line instead.
+     */
+    auto buildFileFilter(const boost::program_options::variables_map& vm)
+        -> std::expected<mvgltools::mdb1::FileFilter, std::string>
+    {
+        mvgltools::mdb1::FileFilter filter;
+        const auto useRegex = vm["regex"].as<bool>();
+
+        for (const auto* option : {"include", "exclude"})
+        {
+            if (!vm.contains(option)) continue;
+
+            const auto exclude = std::string_view(option) == "exclude";
+            for (const auto& pattern : vm[option].as<std::vector<std::string>>())
+            {
+                if (pattern.starts_with('@'))
+                {
+                    std::ifstream list(pattern.substr(1));
+                    if (!list) return std::unexpected(std::format("Error: failed to read {}.", pattern.substr(1)));
+
+                    for (std::string line; std::getline(list, line);)
+                    {
+                        if (line.ends_with('\r')) line.pop_back();
+                        if (!line.empty()) filter.addName(line, exclude);
+                    }
+                    continue;
+                }
+
+                auto result = useRegex ? filter.addRegex(pattern, exclude) : filter.addGlob(pattern, exclude);
+                if (!result) return std::unexpected(result.error());
+            }
+        }
+
+        return filter;
+    }
+
+    /**
+     * Print the errors of a parallel run and a summary line, e.g. "Converted 5 of 6 files."
+     */
+    void printResults(const std::vector<std::filesystem::path>& paths,
+                      const std::vector<std::expected<void, std::string>>& results,
+                      std::string_view verb)
+    {
+        size_t failed = 0;
+        for (const auto& [path, result] : std::views::zip(paths, results))
+        {
+            if (result) continue;
+            std::cout << path << ": " << result.error() << "\n";
+            failed++;
+        }
+
+        std::cout << std::format("{} {} of {} files.\n", verb, paths.size() - failed, paths.size());
+    }
+
     template<GameModules T>
     struct GameCLI
     {
         static void packMVGL(const std::filesystem::path& source,
                              const std::filesystem::path& target,
-                             mvgltools::mdb1::CompressMode compress)
+                             mvgltools::mdb1::CompressMode compress,
+                             size_t reserve)
         {
-            auto result = mvgltools::mdb1::packArchive<typename T::MDB1Module>(source, target, compress);
+            auto result = mvgltools::mdb1::packArchive<typename T::MDB1Module>(source, target, compress, reserve);
             if (!result) std::cout << result.error() << "\n";
         }
-        static void unpackMVGL(const std::filesystem::path& source, const std::filesystem::path& target)
+        static void updateMVGL(const std::filesystem::path& source,
+                               const std::filesystem::path& target,
+                               mvgltools::mdb1::CompressMode compress,
+                               size_t reserve)
         {
-            mvgltools::mdb1::ArchiveInfo<typename T::MDB1Module> archive(source);
-            auto result = archive.extract(target);
-            if (!result) std::cout << result.error() << "\n";
+            mvgltools::mdb1::ArchiveBuilder<typename T::MDB1Module> builder;
+            auto added = builder.addDirectory(source);
+            if (!added)
+            {
+                std::cout << added.error() << "\n";
+                return;
+            }
+
+            auto result = builder.update(target, compress, reserve);
+            if (!result)
+            {
+                std::cout << result.error() << "\n";
+                return;
+            }
+
+            std::cout << std::format("Added {} and replaced {} files{}.\n",
+                                     result->addedFiles,
+                                     result->replacedFiles,
+                                     result->rewritten ? ", the archive had to be rewritten" : "");
         }
-        static void unpackMVGLFile(const std::filesystem::path& source,
-                                   const std::filesystem::path& target,
-                                   const std::string& file)
+        static void unpackMVGL(const std::filesystem::path& source,
+                               const std::filesystem::path& target,
+                               const mvgltools::mdb1::ExtractOptions& options,
+                               OutputFormat format)
         {
             mvgltools::mdb1::ArchiveInfo<typename T::MDB1Module> archive(source);
-            auto result = archive.extractSingleFile(target, file);
-            if (!result) std::cout << result.error() << "\n";
+            if (format == OutputFormat::FOLDER)
+            {
+                auto result = archive.extract(target, options);
+                if (!result) std::cout << result.error() << "\n";
+                return;
+            }
+
+            // the tar itself might go to stdout, so errors go to stderr
+            if (target == STDOUT_PATH)
+            {
+                auto result = archive.extractTar(getBinaryStdout(), options);
+                if (!result) std::cerr << result.error() << "\n";
+                return;
+            }
+
+            std::ofstream output(target, std::ios::binary);
+            if (!output)
+            {
+                std::cerr << "Error: failed to open the output file.\n";
+                return;
+            }
+
+            auto result = archive.extractTar(output, options);
+            if (!result) std::cerr << result.error() << "\n";
         }
+        static void mergeMVGL(const std::filesystem::path& source,
+                              const std::filesystem::path& target,
+                              const std::vector<std::string>& merge,
+                              mvgltools::mdb1::CompressMode compress)
+        {
+            std::vector<std::filesystem::path> sources{source};
+            sources.insert(sources.end(), merge.begin(), merge.end());
 
-        static void unpackMBE(const std::filesystem::path& source, const std::filesystem::path& target)
+            auto result = mvgltools::mdb1::mergeArchives<typename T::MDB1Module>(sources, target, compress);
+            if (!result) std::cout << result.error() << "\n";
+        }
+        static void compactMVGL(const std::filesystem::path& source,
+                                const std::filesystem::path& target,
+                                bool deduplicate)
         {
-            std::cout << source << "\n";
-            auto result = mvgltools::expa::readEXPA<typename T::EXPAModule>(source);
+            auto result = mvgltools::mdb1::compactArchive<typename T::MDB1Module>(source, target, deduplicate);
             if (!result)
             {
                 std::cout << result.error() << "\n";
                 return;
             }
 
-            auto result2 = mvgltools::expa::exportCSV(result.value(), target / source.filename());
-            if (!result2) std::cout << result2.error() << "\n";
+            std::cout << std::format("Removed {} unused and {} duplicate data entries, reclaimed {} bytes.\n",
+                                     result->removedEntries,
+                                     result->mergedEntries,
+                                     static_cast<int64_t>(result->oldSize) - static_cast<int64_t>(result->newSize));
         }
-
-        static void packMBE(const std::filesystem::path& source, const std::filesystem::path& target)
+        static void printPatchSummary(const mvgltools::mdb1::PatchSummary& summary)
         {
-            std::cout << source << "\n";
-            auto result = mvgltools::expa::importCSV<typename T::EXPAModule>(source);
+            std::cout << std::format("{} added, {} removed and {} replaced files, {} bytes of data.\n",
+                                     summary.addedFiles,
+                                     summary.removedFiles,
+                                     summary.replacedFiles,
+                                     summary.dataSize);
+        }
+        static void diffMVGL(const std::filesystem::path& source,
+                             const std::filesystem::path& target,
+                             const std::filesystem::path& base)
+        {
+            auto result = mvgltools::mdb1::createPatch<typename T::MDB1Module>(base, source, target);
+            if (!result)
+                std::cout << result.error() << "\n";
+            else
+                printPatchSummary(result.value());
+        }
+        static void applyMVGLPatch(const std::filesystem::path& source,
+                                   const std::filesystem::path& target,
+                                   const std::filesystem::path& base)
+        {
+            auto result = mvgltools::mdb1::applyPatch<typename T::MDB1Module>(base, source, target);
+            if (!result)
+                std::cout << result.error() << "\n";
+            else
+                printPatchSummary(result.value());
+        }
+        static void convertMVGL(const std::filesystem::path& source, const std::filesystem::path& target)
+        {
+            auto result = T::CryptModule::convertArchive(source, target);
+            if (!result)
+                std::cout << result.error() << "\n";
+            else if (result.value() == mvgltools::mdb1::ArchiveEncryption::ENCRYPTED)
+                std::cout << "Encrypted the archive, use it with --game=dscs.\n";
+            else
+                std::cout << "Decrypted the archive, use it with --game=dscs-console.\n";
+        }
+        static void verifyMVGL(const std::filesystem::path& source, uint32_t jobs)
+        {
+            auto start = std::chrono::steady_clock::now();
+            mvgltools::mdb1::ArchiveInfo<typename T::MDB1Module> archive(source);
+            auto result = archive.verify(jobs);
             if (!result)
             {
                 std::cout << result.error() << "\n";
                 return;
             }
 
-            auto result2 = mvgltools::expa::writeEXPA<typename T::EXPAModule>(result.value(), target);
-            if (!result2) std::cout << result2.error() << "\n";
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+            for (const auto& error : result->errors)
+                std::cout << error << "\n";
+
+            std::cout << std::format("Checked {} files with {} data entries, {:.1f} MB in {:.2f}s ({:.1f} MB/s).\n",
+                                     result->fileCount,
+                                     result->dataCount,
+                                     static_cast<double>(result->fullSize) / 1000000.0,
+                                     seconds.count(),
+                                     static_cast<double>(result->fullSize) / 1000000.0 / seconds.count());
+            if (result->errors.empty())
+                std::cout << "The archive is fine.\n";
+            else
+                std::cout << std::format("Found {} problems.\n", result->errors.size());
+        }
+        static void unpackMVGLFile(const std::filesystem::path& source,
+                                   const std::filesystem::path& target,
+                                   const std::string& file)
+        {
+            mvgltools::mdb1::ArchiveInfo<typename T::MDB1Module> archive(source);
+            if (target == STDOUT_PATH)
+            {
+                getBinaryStdout();
+                auto result = archive.extractSingleFileToStdout(file);
+                if (!result) std::cerr << result.error() << "\n";
+                return;
+            }
+
+            auto result = archive.extractSingleFile(target, file);
+            if (!result) std::cout << result.error() << "\n";
+        }
+
+        static auto convertMBE(const std::filesystem::path& source, const std::filesystem::path& target)
+            -> std::expected<void, std::string>
+        {
+            return mvgltools::expa::convertEXPAToCSV<typename T::EXPAModule>(source, target / source.filename());
+        }
+
+        static auto convertCSV(const std::filesystem::path& source, const std::filesystem::path& target)
+            -> std::expected<void, std::string>
+        {
+            return mvgltools::expa::convertCSVToEXPA<typename T::EXPAModule>(source, target);
+        }
+
+        static void unpackMBE(const std::filesystem::path& source, const std::filesystem::path& target)
+        {
+            std::cout << source << "\n";
+            auto result = convertMBE(source, target);
+            if (!result) std::cout << result.error() << "\n";
+        }
+
+        static void packMBE(const std::filesystem::path& source, const std::filesystem::path& target)
+        {
+            std::cout << source << "\n";
+            auto result = convertCSV(source, target);
+            if (!result) std::cout << result.error() << "\n";
         }
 
-        static void unpackMBEDir(const std::filesystem::path& source, const std::filesystem::path& target)
+        static void unpackMBEDir(const std::filesystem::path& source,
+                                 const std::filesystem::path& target,
+                                 uint32_t jobs)
         {
             if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source)) return;
             if (std::filesystem::exists(target) && !std::filesystem::is_directory(target)) return;
 
             std::filesystem::create_directories(target);
 
-            const std::filesystem::directory_iterator itr(source);
+            std::vector<std::filesystem::path> files;
+            for (const auto& file : std::filesystem::directory_iterator(source))
+                if (file.is_regular_file()) files.push_back(file.path());
 
-            for (const auto& file : itr)
-                if (file.is_regular_file()) unpackMBE(file, target);
+            auto results = runParallel(files, jobs, [&](const auto& file) { return convertMBE(file, target); });
+            printResults(files, results, "Converted");
         }
 
-        static void packMBEDir(const std::filesystem::path& source, const std::filesystem::path& target)
+        static void packMBEDir(const std::filesystem::path& source, const std::filesystem::path& target, uint32_t jobs)
         {
             if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source)) return;
             if (std::filesystem::exists(target) && !std::filesystem::is_directory(target)) return;
 
             std::filesystem::create_directories(target);
 
-            const std::filesystem::directory_iterator itr(source);
+            std::vector<std::filesystem::path> files;
+            for (const auto& file : std::filesystem::directory_iterator(source))
+                if (file.is_directory()) files.push_back(file.path());
 
-            for (const auto& file : itr)
-                if (file.is_directory()) packMBE(file.path(), target / file.path().filename());
+            auto results =
+                runParallel(files, jobs, [&](const auto& file) { return convertCSV(file, target / file.filename()); });
+            printResults(files, results, "Converted");
         }
 
-        static void dumpMBEStructures([[maybe_unused]] const std::filesystem::path& source,
-                                      [[maybe_unused]] const std::filesystem::path& target)
+        static void unpackMVGLCSV(const std::filesystem::path& source,
+                                  const std::filesystem::path& target,
+                                  uint32_t jobs)
         {
-            if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source)) return;
             if (std::filesystem::exists(target) && !std::filesystem::is_directory(target)) return;
 
-            std::filesystem::create_directories(target);
+            mvgltools::mdb1::ArchiveInfo<typename T::MDB1Module> archive(source);
+            if (!archive.isValid())
+            {
+                std::cout << std::format("Error: {} is not a valid MDB1 file.\n", source.string());
+                return;
+            }
 
-            const std::filesystem::recursive_directory_iterator itr(source);
+            std::vector<std::filesystem::path> files;
+            for (auto name : archive.getFiles())
+            {
+                if (!name.ends_with(".mbe")) continue;
 
-            boost::property_tree::ptree structureMap;
+                std::ranges::replace(name, '\\', '/');
+                files.emplace_back(name);
+            }
 
-            for (const auto& file : itr)
+            auto convertFile = [&](const std::filesystem::path& file) -> std::expected<void, std::string>
             {
-                if (!file.is_regular_file() && file.path().extension() != "mbe") continue;
+                auto data = archive.readFile(file.string());
+                if (!data) return std::unexpected(data.error());
 
-                auto table = mvgltools::expa::readEXPA<typename T::EXPAModule>(file);
-                if (!table) continue;
+                return mvgltools::expa::convertEXPAToCSV<typename T::EXPAModule>(data.value(), file, target / file);
+            };
 
-                auto jsonName = std::format("{}.json", file.path().filename().string());
-                auto path     = boost::property_tree::ptree::path_type{file.path().filename().stem().string(), '\\'};
-                structureMap.add(path, jsonName);
+            auto results = runParallel(files, jobs, convertFile);
+            printResults(files, results, "Converted");
+        }
+
+        static void packMVGLCSV(const std::filesystem::path& source,
+                                const std::filesystem::path& target,
+                                mvgltools::mdb1::CompressMode compress)
+        {
+            if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source)) return;
+
+            mvgltools::mdb1::ArchiveBuilder<typename T::MDB1Module> builder;
+            for (auto itr = std::filesystem::recursive_directory_iterator(source);
+                 itr != std::filesystem::recursive_directory_iterator();
+                 ++itr)
+            {
+                auto path     = itr->path();
+                auto relative = std::filesystem::relative(path, source);
+
+                // folders named like a .mbe file contain its tables as CSV
+                if (itr->is_directory() && path.extension() == ".mbe")
+                {
+                    itr.disable_recursion_pending();
+                    builder.addGenerated(relative,
+                                         [path]
+                                         { return mvgltools::expa::convertCSVToEXPA<typename T::EXPAModule>(path); });
+                }
+                else if (itr->is_regular_file())
+                    builder.addFile(relative, path);
+            }
+
+            auto result = builder.build(target, compress);
+            if (!result) std::cout << result.error() << "\n";
+        }
+
+        static void dumpMBEStructures(const std::filesystem::path& source,
+                                      const std::filesystem::path& target,
+                                      uint32_t jobs)
+        {
+            if (!std::filesystem::exists(source) || !std::filesystem::is_directory(source)) return;
+            if (std::filesystem::exists(target) && !std::filesystem::is_directory(target)) return;
+
+            std::filesystem::create_directories(target);
+
+            // files are identified by their name, so only keep one file per name
+            std::map<std::filesystem::path, std::filesystem::path> fileMap;
+            for (const auto& file : std::filesystem::recursive_directory_iterator(source))
+            {
+                if (!file.is_regular_file() || file.path().extension() != ".mbe") continue;
+
+                auto& entry = fileMap[file.path().filename()];
+                if (entry.empty() || entry < file.path()) entry = file.path();
+            }
+
+            auto files = fileMap | std::views::values | std::ranges::to<std::vector<std::filesystem::path>>();
+
+            auto dumpFile = [&](const std::filesystem::path& file) -> std::expected<void, std::string>
+            {
+                auto structures = mvgltools::expa::readEXPAStructures<typename T::EXPAModule>(file);
+                if (!structures) return std::unexpected(structures.error());
 
                 boost::property_tree::ptree structure;
-                for (const auto& table : table.value().tables)
+                for (const auto& [name, tableStructure] : structures.value())
                 {
                     boost::property_tree::ptree tableTree;
 
-                    for (const auto& entry : table.structure.getStructure())
+                    for (const auto& entry : tableStructure.getStructure())
                         tableTree.add(entry.name, mvgltools::expa::detail::toString(entry.type));
 
-                    structure.add_child(table.name, tableTree);
+                    structure.add_child(name, tableTree);
                 }
 
-                std::ofstream fileFile(target / jsonName);
+                std::ofstream fileFile(target / std::format("{}.json", file.filename().string()));
                 boost::property_tree::write_json(fileFile, structure);
+                return {};
+            };
+
+            auto results = runParallel(files, jobs, dumpFile);
+            printResults(files, results, "Dumped");
+
+            boost::property_tree::ptree structureMap;
+            for (const auto& [file, result] : std::views::zip(files, results))
+            {
+                if (!result) continue;
+
+                auto jsonName = std::format("{}.json", file.filename().string());
+                auto path     = boost::property_tree::ptree::path_type{file.filename().stem().string(), '\\'};
+                structureMap.add(path, jsonName);
             }
 
             structureMap.sort();
@@ -454,46 +856,92 @@ namespace
         static void encryptFile(const std::filesystem::path& source, const std::filesystem::path& target)
         {
             auto result = T::CryptModule::encrypt(source, target);
-            if (!result) std::cout << result.error() << "\n";
+            if (!result) getErrorStream(target) << result.error() << "\n";
         }
 
         static void decryptFile(const std::filesystem::path& source, const std::filesystem::path& target)
         {
             auto result = T::CryptModule::decrypt(source, target);
-            if (!result) std::cout << result.error() << "\n";
+            if (!result) getErrorStream(target) << result.error() << "\n";
         }
 
         static void doAction(Mode mode, const boost::program_options::variables_map& vm)
         {
             const std::filesystem::path source = vm["input"].as<std::string>();
-            const std::filesystem::path target = vm["output"].as<std::string>();
+            const std::filesystem::path target = vm.contains("output") ? vm["output"].as<std::string>() : "";
+            const auto jobs                    = vm["jobs"].as<uint32_t>();
 
             switch (mode)
             {
                 case Mode::PACK_MVGL:
                 {
                     auto compress = vm["compress"].as<mvgltools::mdb1::CompressMode>();
-                    packMVGL(source, target, compress);
+                    packMVGL(source, target, compress, vm["reserve"].as<size_t>());
+                    break;
+                }
+                case Mode::UPDATE_MVGL:
+                {
+                    auto compress = vm["compress"].as<mvgltools::mdb1::CompressMode>();
+                    updateMVGL(source, target, compress, vm["reserve"].as<size_t>());
+                    break;
+                }
+                case Mode::UNPACK_MVGL:
+                {
+                    auto filter = buildFileFilter(vm);
+                    if (!filter)
+                    {
+                        std::cout << filter.error() << "\n";
+                        break;
+                    }
+
+                    mvgltools::mdb1::ExtractOptions options{
+                        .filter     = std::move(filter.value()),
+                        .jobs       = jobs,
+                        .duplicates = vm["duplicates"].as<mvgltools::mdb1::DuplicateMode>(),
+                        .manifest   = vm.contains("manifest") ? vm["manifest"].as<std::string>() : "",
+                    };
+                    // writing to stdout is only possible as a tar
+                    auto format = target == STDOUT_PATH ? OutputFormat::TAR : vm["format"].as<OutputFormat>();
+                    unpackMVGL(source, target, options, format);
                     break;
                 }
-                case Mode::UNPACK_MVGL: unpackMVGL(source, target); break;
                 case Mode::UNPACK_MVGL_FILE:
                 {
                     auto file = vm["file"].as<std::string>();
                     unpackMVGLFile(source, target, file);
                     break;
                 }
+                case Mode::PACK_MVGL_CSV:
+                {
+                    auto compress = vm["compress"].as<mvgltools::mdb1::CompressMode>();
+                    packMVGLCSV(source, target, compress);
+                    break;
+                }
+                case Mode::UNPACK_MVGL_CSV: unpackMVGLCSV(source, target, jobs); break;
+                case Mode::MERGE_MVGL:
+                {
+                    auto compress = vm["compress"].as<mvgltools::mdb1::CompressMode>();
+                    auto merge    = vm.contains("merge") ? vm["merge"].as<std::vector<std::string>>()
+                                                         : std::vector<std::string>{};
+                    mergeMVGL(source, target, merge, compress);
+                    break;
+                }
+                case Mode::DIFF_MVGL: diffMVGL(source, target, vm["base"].as<std::string>()); break;
+                case Mode::APPLY_MVGL_PATCH: applyMVGLPatch(source, target, vm["base"].as<std::string>()); break;
+                case Mode::COMPACT_MVGL: compactMVGL(source, target, vm["deduplicate"].as<bool>()); break;
+                case Mode::CONVERT_MVGL: convertMVGL(source, target); break;
+                case Mode::VERIFY_MVGL: verifyMVGL(source, jobs); break;
                 case Mode::UNPACK_MBE: unpackMBE(source, target); break;
-                case Mode::UNPACK_MBE_DIR: unpackMBEDir(source, target); break;
+                case Mode::UNPACK_MBE_DIR: unpackMBEDir(source, target, jobs); break;
                 case Mode::PACK_MBE: packMBE(source, target); break;
-                case Mode::PACK_MBE_DIR: packMBEDir(source, target); break;
+                case Mode::PACK_MBE_DIR: packMBEDir(source, target, jobs); break;
                 case Mode::ENCRYPT_FILE: encryptFile(source, target); break;
                 case Mode::DECRYPT_FILE: decryptFile(source, target); break;
                 case Mode::ENCRYPT_SAVE: encryptSave(source, target); break;
                 case Mode::DECRYPT_SAVE: decryptSave(source, target); break;
                 case Mode::PACK_AFS2: packAFS2(source, target); break;
                 case Mode::UNPACK_AFS2: unpackAFS2(source, target); break;
-                case Mode::DUMP_MBE_STRUCTURES: dumpMBEStructures(source, target); break;
+                case Mode::DUMP_MBE_STRUCTURES: dumpMBEStructures(source, target, jobs); break;
                 case Mode::INVALID: std::cout << "Invalid mode!\n"; break;
             }
         }
@@ -520,6 +968,35 @@ namespace
         map["extractmvglfile"]   = Mode::UNPACK_MVGL_FILE;
         map["extract-mvgl-file"] = Mode::UNPACK_MVGL_FILE;
 
+        map["packmvglcsv"]   = Mode::PACK_MVGL_CSV;
+        map["pack-mvgl-csv"] = Mode::PACK_MVGL_CSV;
+
+        map["unpackmvglcsv"]    = Mode::UNPACK_MVGL_CSV;
+        map["unpack-mvgl-csv"]  = Mode::UNPACK_MVGL_CSV;
+        map["extractmvglcsv"]   = Mode::UNPACK_MVGL_CSV;
+        map["extract-mvgl-csv"] = Mode::UNPACK_MVGL_CSV;
+
+        map["mergemvgl"]  = Mode::MERGE_MVGL;
+        map["merge-mvgl"] = Mode::MERGE_MVGL;
+
+        map["updatemvgl"]  = Mode::UPDATE_MVGL;
+        map["update-mvgl"] = Mode::UPDATE_MVGL;
+
+        map["diffmvgl"]  = Mode::DIFF_MVGL;
+        map["diff-mvgl"] = Mode::DIFF_MVGL;
+
+        map["applymvglpatch"]   = Mode::APPLY_MVGL_PATCH;
+        map["apply-mvgl-patch"] = Mode::APPLY_MVGL_PATCH;
+
+        map["compactmvgl"]  = Mode::COMPACT_MVGL;
+        map["compact-mvgl"] = Mode::COMPACT_MVGL;
+
+        map["convertmvgl"]  = Mode::CONVERT_MVGL;
+        map["convert-mvgl"] = Mode::CONVERT_MVGL;
+
+        map["verifymvgl"]  = Mode::VERIFY_MVGL;
+        map["verify-mvgl"] = Mode::VERIFY_MVGL;
+
         map["packmbe"]  = Mode::PACK_MBE;
         map["pack-mbe"] = Mode::PACK_MBE;
 
@@ -595,6 +1072,23 @@ namespace
         return map;
     }
 
+    auto getDuplicateMap() -> std::map<std::string, mvgltools::mdb1::DuplicateMode>
+    {
+        std::map<std::string, mvgltools::mdb1::DuplicateMode> map;
+        map["copy"]     = mvgltools::mdb1::DuplicateMode::COPY;
+        map["reflink"]  = mvgltools::mdb1::DuplicateMode::REFLINK;
+        map["hardlink"] = mvgltools::mdb1::DuplicateMode::HARDLINK;
+        return map;
+    }
+
+    auto getFormatMap() -> std::map<std::string, OutputFormat>
+    {
+        std::map<std::string, OutputFormat> map;
+        map["folder"] = OutputFormat::FOLDER;
+        map["tar"]    = OutputFormat::TAR;
+        return map;
+    }
+
     template<typename T>
     void validate_helper(boost::any& value, const std::vector<std::string>& values, const std::map<std::string, T>& map)
     {
@@ -623,6 +1117,12 @@ namespace
         validate_helper(value, values, map);
     }
 
+    void validate(boost::any& value, const std::vector<std::string>& values, OutputFormat* /*unused*/, int /*unused*/)
+    {
+        static const std::map<std::string, OutputFormat> map = getFormatMap();
+        validate_helper(value, values, map);
+    }
+
 } // namespace
 
 namespace mvgltools::mdb1
@@ -633,6 +1133,13 @@ namespace mvgltools::mdb1
         static const std::map<std::string, CompressMode> map = getCompressionMap();
         validate_helper(value, values, map);
     }
+
+    // NOLINTNEXTLINE(misc-use-internal-linkage)
+    void validate(boost::any& value, const std::vector<std::string>& values, DuplicateMode* /*unused*/, int /*unused*/)
+    {
+        static const std::map<std::string, DuplicateMode> map = getDuplicateMap();
+        validate_helper(value, values, map);
+    }
 } // namespace mvgltools::mdb1
 
 auto main(int argc, char** argv) -> int
@@ -652,6 +1159,15 @@ auto main(int argc, char** argv) -> int
                  "pack-mvgl        -> folder in, file out\n"
                  "unpack-mvgl      -> file in, folder out\n"
                  "unpack-mvgl-file -> file in, file out\n"
+                 "pack-mvgl-csv    -> folder in, file out\n"
+                 "unpack-mvgl-csv  -> file in, folder out\n"
+                 "merge-mvgl       -> file/folder in, file out\n"
+                 "compact-mvgl     -> file in, file out\n"
+                 "update-mvgl      -> folder in, file out (modified in place)\n"
+                 "diff-mvgl        -> file in, file out\n"
+                 "apply-mvgl-patch -> file in, file out\n"
+                 "convert-mvgl     -> file in, file out\n"
+                 "verify-mvgl      -> file in, no output\n"
                  "pack-mbe         -> folder in, file out\n"
                  "unpack-mbe       -> file in, folder out\n"
                  "pack-mbe-dir     -> folder in, folder out\n"
@@ -666,8 +1182,15 @@ auto main(int argc, char** argv) -> int
                  "the input path, must point to file or folder, depending on the mode");
     base_options(
         "output,o",
-        po::value<std::string>()->required(),
-        "the output path, must point to file or folder, depending on the mode.\nWill be created if it doesn't exist.");
+        po::value<std::string>(),
+        "the output path, must point to file or folder, depending on the mode.\nWill be created if it doesn't exist.\n"
+        "- writes to stdout, as a tar for unpack-mvgl, or the file itself for unpack-mvgl-file, encrypt-file and "
+        "decrypt-file.");
+
+    base_options("jobs,j",
+                 po::value<uint32_t>()->default_value(0),
+                 "the number of files to process in parallel, for modes working on whole folders.\n"
+                 "0 uses the number of available cores.");
 
     pos.add("input", 1);
     pos.add("output", 1);
@@ -682,14 +1205,62 @@ auto main(int argc, char** argv) -> int
         "normal   -> use regular compression, as in vanilla files\n"
         "none     -> use no compression\n"
         "advanced -> improve compression by deduplicating, slower");
+    pack_options("reserve",
+                 po::value<size_t>()->default_value(0),
+                 "the number of additional files to reserve table space for, so update-mvgl can add them without "
+                 "rewriting the archive");
 
     po::options_description unpack_desc("MVGL Unpack Options", 120);
     auto unpack_options = unpack_desc.add_options();
     unpack_options("file",
                    po::value<std::string>(),
                    "for unpack-mvgl-file, specifies the file to unpack within the MVGL archive");
+    unpack_options("include",
+                   po::value<std::vector<std::string>>()->multitoken()->composing(),
+                   "for unpack-mvgl, only unpack files matching any of these patterns, e.g. \"*.mbe\" or "
+                   "\"chara/**\".\n@<file> reads a list of file paths, one per line");
+    unpack_options("exclude",
+                   po::value<std::vector<std::string>>()->multitoken()->composing(),
+                   "for unpack-mvgl, don't unpack files matching any of these patterns, same format as --include");
+    unpack_options("regex", po::bool_switch(), "treat --include and --exclude patterns as regular expressions");
+    unpack_options(
+        "duplicates",
+        po::value<mvgltools::mdb1::DuplicateMode>()->default_value(mvgltools::mdb1::DuplicateMode::REFLINK, "reflink"),
+        "how unpack-mvgl writes files sharing their data with another file\n"
+        "reflink  -> share the data on disk if the file system supports it, copy otherwise\n"
+        "hardlink -> share the data on disk if supported, hardlink otherwise\n"
+        "copy     -> always write a full copy");
+    unpack_options("manifest",
+                   po::value<std::string>(),
+                   "for unpack-mvgl, only unpack files that changed since the last time the given manifest file was "
+                   "written, then update it");
+    unpack_options("format",
+                   po::value<OutputFormat>()->default_value(OutputFormat::FOLDER, "folder"),
+                   "what unpack-mvgl writes to the output path\n"
+                   "folder -> the files, in a folder\n"
+                   "tar    -> a tar archive of the files, in the order they're stored in. Files sharing their data are "
+                   "hardlinks with --duplicates=hardlink, copies otherwise");
+
+    po::options_description merge_desc(
+        "MVGL Merge Options\n  Input: Base archive or folder\n  Output: Path of the merged file",
+        120);
+    auto merge_options = merge_desc.add_options();
+    merge_options("merge",
+                  po::value<std::vector<std::string>>()->multitoken()->composing(),
+                  "archives or folders to merge on top of the input, later ones override earlier ones");
+
+    po::options_description patch_desc(
+        "MVGL Patch Options\n  diff-mvgl: Input: the new archive, Output: the patch file\n"
+        "  apply-mvgl-patch: Input: the patch file, Output: the new archive",
+        120);
+    auto patch_options = patch_desc.add_options();
+    patch_options("base", po::value<std::string>(), "the old archive the patch is created for/applied to");
+
+    po::options_description compact_desc("MVGL Compact Options", 120);
+    auto compact_options = compact_desc.add_options();
+    compact_options("deduplicate", po::bool_switch(), "for compact-mvgl, store identical data only once");
 
-    desc.add(pack_desc).add(unpack_desc);
+    desc.add(pack_desc).add(unpack_desc).add(merge_desc).add(compact_desc).add(patch_desc);
 
     try
     {
@@ -701,6 +1272,9 @@ auto main(int argc, char** argv) -> int
         auto game = vm["game"].as<GameMode>();
         auto mode = vm["mode"].as<Mode>();
 
+        // verify-mvgl is the only mode without an output
+        if (mode != Mode::VERIFY_MVGL && !vm.contains("output")) throw po::required_option("output");
+
         switch (game)
         {
             case GameMode::DSCS: GameCLI<DSCSModule>::doAction(mode, vm); break;
@@ -712,8 +1286,9 @@ auto main(int argc, char** argv) -> int
     }
     catch (std::exception& ex)
     {
-        // must check for size 1, since compress has a default value
-        if (vm.size() == 1 || vm.contains("help"))
+        // options with a default value are always set, so only count the ones given by the user
+        auto isDefault = [](const auto& option) { return option.second.defaulted(); };
+        if (std::ranges::all_of(vm, isDefault) || vm.contains("help"))
             std::cout << desc;
         else
             std::cout << ex.what() << '\n';